@@ -0,0 +1,213 @@
+#include "../include/stream_format.h"
+#include "baseline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+
+/******************************************************************************/
+
+namespace {
+
+// Median absolute deviations this far apart are treated as noise; 1.4826
+// turns a MAD into a standard deviation for normally distributed timings.
+constexpr double NOISE_SIGMAS = 3.0;
+constexpr double MAD_TO_SIGMA = 1.4826;
+
+/**
+ * string_field
+ *
+ * @param line One result record, as written by subaruu_bench
+ * @param key The field to find
+ * @return The field's string value, or empty if it is missing
+ */
+std::string string_field(const std::string& line, const std::string& key) {
+    const std::string needle = "\"" + key + "\": \"";
+    const std::size_t start = line.find(needle);
+    if (start == std::string::npos) {
+        return {};
+    }
+    const std::size_t begin = start + needle.size();
+    const std::size_t end = line.find('"', begin);
+    return end == std::string::npos ? std::string()
+                                    : line.substr(begin, end - begin);
+}
+
+/**
+ * number_field
+ *
+ * @param line One result record, as written by subaruu_bench
+ * @param key The field to find
+ * @return The field's numeric value, or 0 if it is missing
+ */
+double number_field(const std::string& line, const std::string& key) {
+    const std::string needle = "\"" + key + "\": ";
+    const std::size_t start = line.find(needle);
+    if (start == std::string::npos) {
+        return 0;
+    }
+    return std::strtod(line.c_str() + start + needle.size(), nullptr);
+}
+
+/**
+ * relative_noise
+ *
+ * @param result A measured or recorded result
+ * @return The result's spread as a fraction of its throughput
+ */
+double relative_noise(const Result& result) {
+    return result.throughput > 0
+             ? NOISE_SIGMAS * MAD_TO_SIGMA * result.mad / result.throughput
+             : 0;
+}
+
+/**
+ * find_result
+ *
+ * @param results The results to look in
+ * @param workload The workload to find
+ * @param phase Its phase
+ * @return The result, or nullptr if there is none with a throughput
+ */
+const Result* find_result(const std::vector<Result>& results,
+                          const std::string& workload,
+                          const std::string& phase) {
+    auto found = std::find_if(
+      results.begin(), results.end(), [&](const Result& result) {
+          return result.workload == workload && result.phase == phase;
+      });
+    return found == results.end() || found->throughput <= 0 ? nullptr
+                                                             : &*found;
+}
+
+} // namespace
+
+/**
+ * read_results
+ *
+ * The writer puts every result on a line of its own, so records are read a
+ * line at a time rather than with a general JSON parser.
+ *
+ * @param path The results file
+ * @param scale Set to the scale the results were taken at
+ * @param results Filled with one entry per result record
+ * @return false if the file cannot be opened or holds no results
+ */
+bool read_results(const std::string& path,
+                  double& scale,
+                  std::vector<Result>& results) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.find("\"scale\": ") != std::string::npos) {
+            scale = number_field(line, "scale");
+        }
+        if (line.find("\"workload\": ") == std::string::npos) {
+            continue;
+        }
+        Result result;
+        result.workload = string_field(line, "workload");
+        result.phase = string_field(line, "phase");
+        result.unit = string_field(line, "unit");
+        result.throughput = number_field(line, "throughput");
+        result.mad = number_field(line, "mad_throughput");
+        results.push_back(result);
+    }
+    return !results.empty();
+}
+
+/**
+ * compare_results
+ *
+ * A result regresses when its throughput falls by more than threshold
+ * percent and the fall is also larger than the noise of the two runs
+ * together, and than min_noise, so a jittery phase does not fail the gate
+ * on its own. When both runs timed the reference loop, each throughput is
+ * first divided by the reference's, so a baseline recorded on a faster or
+ * less busy machine is scaled to this one.
+ *
+ * @param baseline The recorded results
+ * @param current The results just measured
+ * @param threshold The allowed slowdown, in percent
+ * @param min_noise The least noise a comparison is taken to have, in
+ *        percent
+ * @param out Where the comparison table goes
+ * @param regressed Filled with the indices in current that regressed
+ * @return The number of regressions
+ */
+int compare_results(const std::vector<Result>& baseline,
+                    const std::vector<Result>& current,
+                    double threshold,
+                    double min_noise,
+                    std::ostream& out,
+                    std::vector<std::size_t>& regressed) {
+    const StreamFormat format(out);
+    regressed.clear();
+    const Result* then_reference =
+      find_result(baseline, REFERENCE_WORKLOAD, REFERENCE_PHASE);
+    const Result* now_reference =
+      find_result(current, REFERENCE_WORKLOAD, REFERENCE_PHASE);
+    const bool scaled = then_reference && now_reference;
+    // How much faster this machine runs the reference loop than the one
+    // the baseline was recorded on, and how sure that is
+    const double speed =
+      scaled ? now_reference->throughput / then_reference->throughput : 1;
+    const double speed_noise =
+      scaled ? std::hypot(relative_noise(*then_reference),
+                          relative_noise(*now_reference))
+             : 0;
+    if (scaled) {
+        out << "Scaled by the reference loop, which runs at " << std::fixed
+            << std::setprecision(2) << speed * 100
+            << "% of its baseline speed\n";
+    }
+    out << std::left << std::setw(16) << "workload" << std::setw(8) << "phase"
+        << std::right << std::setw(14) << "baseline" << std::setw(14)
+        << "current" << std::setw(10) << "change" << std::setw(10) << "noise"
+        << "  status\n";
+    for (std::size_t i = 0; i < current.size(); ++i) {
+        const Result& now = current[i];
+        const Result* match = find_result(baseline, now.workload, now.phase);
+        out << std::left << std::setw(16) << now.workload << std::setw(8)
+            << now.phase << std::right << std::fixed << std::setprecision(2);
+        if (!match) {
+            out << std::setw(14) << "-" << std::setw(14) << now.throughput
+                << std::setw(10) << "-" << std::setw(10) << "-"
+                << "  new\n";
+            continue;
+        }
+        if (now.workload == REFERENCE_WORKLOAD) {
+            out << std::setw(14) << match->throughput << std::setw(14)
+                << now.throughput << std::setw(10) << "-" << std::setw(10)
+                << "-" << "  reference\n";
+            continue;
+        }
+        const double change =
+          (now.throughput / speed - match->throughput) / match->throughput;
+        // The spread of a difference adds the spreads of both sides, and
+        // of the reference when it scales them
+        const double noise = std::max(
+          min_noise / 100,
+          std::hypot(
+            relative_noise(*match), relative_noise(now), speed_noise));
+        const char* status = "ok";
+        if (-change * 100 > threshold && -change > noise) {
+            status = "REGRESSED";
+            regressed.push_back(i);
+        } else if (-change * 100 > threshold) {
+            status = "noisy";
+        } else if (change * 100 > threshold && change > noise) {
+            status = "faster";
+        }
+        out << std::setw(14) << match->throughput << std::setw(14)
+            << now.throughput << std::setw(9) << std::showpos << change * 100
+            << "%" << std::noshowpos << std::setw(9) << noise * 100 << "%  "
+            << status << "\n";
+    }
+    return static_cast<int>(regressed.size());
+}
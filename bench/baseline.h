@@ -0,0 +1,37 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Summary of one phase of one workload, as measured or as read back from
+// a results file.
+struct Result {
+        std::string workload;
+        std::string phase;
+        std::string unit;
+        double throughput = 0; // Median over the repetitions
+        double mad = 0;        // Median absolute deviation of the throughput
+};
+
+// Reads a results file written by subaruu_bench. Returns false if the file
+// cannot be opened or holds no results.
+bool read_results(const std::string& path,
+                  double& scale,
+                  std::vector<Result>& results);
+
+// The fixed loop timed alongside the interpreter's phases. When both runs
+// have it, throughputs are compared as ratios to it.
+inline constexpr const char* REFERENCE_WORKLOAD = "reference";
+inline constexpr const char* REFERENCE_PHASE = "hash";
+
+// Prints a comparison table and returns how many results regressed by more
+// than threshold percent and by more than the measured noise, which is
+// never taken to be under min_noise percent. Their indices in current go
+// into regressed.
+int compare_results(const std::vector<Result>& baseline,
+                    const std::vector<Result>& current,
+                    double threshold,
+                    double min_noise,
+                    std::ostream& out,
+                    std::vector<std::size_t>& regressed);
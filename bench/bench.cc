@@ -0,0 +1,436 @@
+#include "../include/subaruu.h"
+#include "../include/tokenizer.h"
+#include "baseline.h"
+#include "workloads.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/******************************************************************************/
+
+namespace {
+
+const char USAGE[] =
+  "Usage: ./subaruu_bench [-scale f] [-reps n] [-only workload]\n"
+  "                       [-dir work_dir] [-o results.json]\n"
+  "                       [-check baseline.json] [-threshold percent]\n"
+  "                       [-min-noise percent] [-generate]\n";
+
+// Command line switches.
+struct Options {
+        double scale = 1.0;
+        int reps = 3;
+        std::string only;
+        std::string dir = "bench/work";
+        std::string output = "bench_results.json";
+        std::string baseline;
+        double threshold = 10;
+        double min_noise = 2; // The least noise -check assumes, in percent
+        bool generate_only = false; // Write the workloads, time nothing
+};
+
+// Timings of one phase of one workload.
+struct Measurement {
+        std::string workload;
+        std::string phase;
+        std::string unit;
+        double work = 0; // Megabytes or millions of lines
+        std::vector<double> seconds;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Phases quicker than this are repeated and averaged so that small
+// workloads are not lost in timer noise.
+constexpr double MIN_SAMPLE_SECONDS = 0.05;
+
+// With fewer repetitions than this the spread of a phase cannot be told
+// from chance, so -check prints the comparison without failing on it.
+constexpr int MIN_CHECK_REPS = 5;
+
+// Bytes hashed by the reference loop, about a millisecond's work.
+constexpr std::size_t REFERENCE_BYTES = 1 << 20;
+// Where the reference hash goes, so the loop is not optimized away.
+volatile std::uint32_t reference_sink;
+
+/**
+ * elapsed
+ *
+ * @param start When the timed section started
+ * @return Seconds since start
+ */
+double elapsed(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/**
+ * median
+ *
+ * @param values The samples, copied so they can be reordered
+ * @return The median sample
+ */
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    const std::size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid]
+                             : (values[mid - 1] + values[mid]) / 2;
+}
+
+/**
+ * summarize
+ *
+ * @param m The timings of one phase
+ * @return Median throughput and its median absolute deviation
+ */
+Result summarize(const Measurement& m) {
+    std::vector<double> throughputs;
+    for (double seconds : m.seconds) {
+        throughputs.push_back(m.work / seconds);
+    }
+    const double middle = median(throughputs);
+    std::vector<double> deviations;
+    for (double throughput : throughputs) {
+        deviations.push_back(std::abs(throughput - middle));
+    }
+    return { m.workload, m.phase, m.unit, middle, median(deviations) };
+}
+
+/**
+ * time_lex
+ *
+ * Runs the tokenizer over the whole file, as -debug does, without
+ * printing anything.
+ *
+ * @param path The program to tokenize
+ * @return Seconds taken
+ */
+double time_lex(const std::string& path) {
+    const auto start = Clock::now();
+    Tokenizer tokenizer(path);
+    while (!tokenizer.finished()) {
+        tokenizer.next_token();
+    }
+    return elapsed(start);
+}
+
+/**
+ * time_load
+ *
+ * @param path The program to load
+ * @return Seconds taken to open the file and build the line map
+ */
+double time_load(const std::string& path) {
+    const auto start = Clock::now();
+    SUBARUU interpreter(path);
+    interpreter.load();
+    return elapsed(start);
+}
+
+/**
+ * time_run
+ *
+ * Loads the program untimed, then times run() with its output going to
+ * /dev/null so flushes still cost what they cost in production.
+ *
+ * @param path The program to run
+ * @return Seconds taken by run()
+ */
+double time_run(const std::string& path) {
+    std::ofstream null_output("/dev/null");
+    SUBARUU interpreter(path);
+    interpreter.load();
+
+    std::streambuf* old_cout = std::cout.rdbuf(null_output.rdbuf());
+    double seconds = 0;
+    try {
+        const auto start = Clock::now();
+        interpreter.run();
+        seconds = elapsed(start);
+    } catch (...) {
+        std::cout.rdbuf(old_cout);
+        throw;
+    }
+    std::cout.rdbuf(old_cout);
+    return seconds;
+}
+
+/**
+ * time_reference
+ *
+ * Hashes a fixed buffer with FNV-1a. It shares no code with the
+ * interpreter, so its speed follows the machine alone and -check can
+ * scale a baseline taken elsewhere, or while the machine was busier, by
+ * it.
+ *
+ * @param path Unused
+ * @return Seconds taken
+ */
+double time_reference(const std::string&) {
+    static const std::vector<unsigned char> bytes(REFERENCE_BYTES, 'x');
+    const auto start = Clock::now();
+    std::uint32_t hash = 2166136261u;
+    for (unsigned char byte : bytes) {
+        hash = (hash ^ byte) * 16777619u;
+    }
+    reference_sink = hash;
+    return elapsed(start);
+}
+
+/**
+ * sample
+ *
+ * @param phase One of time_lex, time_load or time_run
+ * @param path The program to measure
+ * @return Seconds per call, averaged over enough calls to fill
+ *         MIN_SAMPLE_SECONDS
+ */
+double sample(double (*phase)(const std::string&), const std::string& path) {
+    double total = 0;
+    int calls = 0;
+    do {
+        total += phase(path);
+        ++calls;
+    } while (total < MIN_SAMPLE_SECONDS);
+    return total / calls;
+}
+
+// The phases timed for each workload, in the order of its results.
+constexpr double (*PHASES[])(const std::string&) = { &time_lex,
+                                                     &time_load,
+                                                     &time_run };
+constexpr std::size_t PHASE_COUNT = std::size(PHASES);
+
+/**
+ * parse_options
+ *
+ * @param argc Argument count from main
+ * @param argv Argument vector from main
+ * @param options Filled in from the arguments
+ * @return false on an unknown switch or a missing value
+ */
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "-scale") == 0 && has_value) {
+            options.scale = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "-reps") == 0 && has_value) {
+            options.reps = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "-only") == 0 && has_value) {
+            options.only = argv[++i];
+        } else if (std::strcmp(argv[i], "-dir") == 0 && has_value) {
+            options.dir = argv[++i];
+        } else if (std::strcmp(argv[i], "-o") == 0 && has_value) {
+            options.output = argv[++i];
+        } else if (std::strcmp(argv[i], "-check") == 0 && has_value) {
+            options.baseline = argv[++i];
+        } else if (std::strcmp(argv[i], "-threshold") == 0 && has_value) {
+            options.threshold = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "-min-noise") == 0 && has_value) {
+            options.min_noise = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "-generate") == 0) {
+            options.generate_only = true;
+        } else {
+            return false;
+        }
+    }
+    return options.scale > 0;
+}
+
+/**
+ * write_json
+ *
+ * @param path The file to write
+ * @param options The options the suite ran with
+ * @param results Every measurement taken
+ * @return false if the file cannot be opened
+ */
+bool write_json(const std::string& path,
+                const Options& options,
+                const std::vector<Measurement>& results) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << std::setprecision(6) << "{\n  \"suite\": \"subaruu\",\n"
+         << "  \"scale\": " << options.scale << ",\n"
+         << "  \"reps\": " << options.reps << ",\n  \"results\": [";
+    bool first = true;
+    for (const auto& m : results) {
+        const Result summary = summarize(m);
+        file << (first ? "\n" : ",\n") << "    { \"workload\": \""
+             << m.workload << "\", \"phase\": \"" << m.phase
+             << "\", \"unit\": \"" << m.unit << "\", \"work\": " << m.work
+             << ", \"median_seconds\": " << median(m.seconds)
+             << ", \"throughput\": " << summary.throughput
+             << ", \"mad_throughput\": " << summary.mad
+             << ", \"seconds\": [";
+        for (std::size_t i = 0; i < m.seconds.size(); ++i) {
+            file << (i ? ", " : "") << m.seconds[i];
+        }
+        file << "] }";
+        first = false;
+    }
+    file << "\n  ]\n}\n";
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << USAGE;
+        return EXIT_FAILURE;
+    }
+    std::filesystem::create_directories(options.dir);
+
+    // Each workload's phases, then the reference loop
+    std::vector<Measurement> results;
+    std::vector<std::string> paths;
+    const auto measure = [&](std::size_t i) {
+        results[i].seconds.push_back(
+          i / PHASE_COUNT < paths.size()
+            ? sample(PHASES[i % PHASE_COUNT], paths[i / PHASE_COUNT])
+            : sample(&time_reference, {}));
+    };
+    try {
+        // Generate everything first so the repetitions can be interleaved:
+        // a slow spell on the machine then widens the spread of every
+        // result instead of shifting one of them.
+        for (const auto& workload : workloads()) {
+            if (!options.only.empty() && workload.name != options.only) {
+                continue;
+            }
+            const std::string path =
+              options.dir + "/" + std::string(workload.name) + ".subaru";
+            std::size_t executed = 0;
+            {
+                std::ofstream file(path, std::ios::trunc);
+                executed = workload.generate(file, options.scale);
+            }
+            const double megabytes =
+              std::filesystem::file_size(path) / (1024.0 * 1024.0);
+            const std::string name(workload.name);
+            results.push_back({ name, "lex", "MB/s", megabytes, {} });
+            results.push_back({ name, "load", "MB/s", megabytes, {} });
+            results.push_back(
+              { name, "run", "Mlines/s", executed / 1e6, {} });
+            paths.push_back(path);
+        }
+        results.push_back({ REFERENCE_WORKLOAD,
+                            REFERENCE_PHASE,
+                            "MB/s",
+                            REFERENCE_BYTES / (1024.0 * 1024.0),
+                            {} });
+        if (options.generate_only) {
+            std::cout << paths.size() << " workloads written to "
+                      << options.dir << "\n";
+            return EXIT_SUCCESS;
+        }
+
+        std::cout << std::left << std::setw(16) << "workload" << std::setw(8)
+                  << "phase" << std::right << std::setw(12) << "ms"
+                  << std::setw(14) << "throughput" << "\n";
+        for (int rep = 0; rep < options.reps; ++rep) {
+            for (std::size_t i = 0; i < results.size(); ++i) {
+                measure(i);
+            }
+        }
+
+        for (const auto& m : results) {
+            const double seconds = median(m.seconds);
+            std::cout << std::left << std::setw(16) << m.workload
+                      << std::setw(8) << m.phase << std::right << std::fixed
+                      << std::setprecision(3) << std::setw(12)
+                      << seconds * 1000 << std::setw(14)
+                      << std::setprecision(2) << m.work / seconds << " "
+                      << m.unit << "\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark Error: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    if (!write_json(options.output, options, results)) {
+        std::cerr << "Failed to open file: " << options.output << "\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "Results written to " << options.output << "\n";
+
+    if (!options.baseline.empty()) {
+        double baseline_scale = 0;
+        std::vector<Result> baseline;
+        if (!read_results(options.baseline, baseline_scale, baseline)) {
+            std::cerr << "Failed to read baseline: " << options.baseline
+                      << "\n";
+            return EXIT_FAILURE;
+        }
+        if (baseline_scale != options.scale) {
+            std::cerr << "Baseline was taken at scale " << baseline_scale
+                      << ", not " << options.scale << "\n";
+            return EXIT_FAILURE;
+        }
+        std::vector<Result> current;
+        for (const auto& m : results) {
+            current.push_back(summarize(m));
+        }
+        std::cout << "\nCompared with " << options.baseline << " (threshold "
+                  << options.threshold << "%):\n";
+        std::vector<std::size_t> regressed;
+        int regressions = compare_results(baseline,
+                                          current,
+                                          options.threshold,
+                                          options.min_noise,
+                                          std::cout,
+                                          regressed);
+        if (regressions > 0 && options.reps >= MIN_CHECK_REPS) {
+            // A slow spell on the machine can pass for a regression, so
+            // what looks slower is timed as many times again, along with
+            // the reference loop, and only fails if it still does
+            std::vector<std::size_t> again = regressed;
+            again.push_back(results.size() - 1);
+            try {
+                for (int rep = 0; rep < options.reps; ++rep) {
+                    for (std::size_t i : again) {
+                        measure(i);
+                    }
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Benchmark Error: " << e.what() << "\n";
+                return EXIT_FAILURE;
+            }
+            std::vector<Result> rechecked;
+            for (std::size_t i : again) {
+                rechecked.push_back(summarize(results[i]));
+            }
+            std::cout << "\nTimed again, " << 2 * options.reps
+                      << " reps in all:\n";
+            regressions = compare_results(baseline,
+                                          rechecked,
+                                          options.threshold,
+                                          options.min_noise,
+                                          std::cout,
+                                          regressed);
+        }
+        if (regressions > 0 && options.reps < MIN_CHECK_REPS) {
+            std::cerr << regressions << " result(s) look slower, but "
+                      << options.reps << " rep(s) are too few to tell; use "
+                      << "-reps " << MIN_CHECK_REPS << " or more\n";
+        } else if (regressions > 0) {
+            std::cerr << regressions << " result(s) regressed by more than "
+                      << options.threshold << "%\n";
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,554 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/******************************************************************************/
+
+// Generates valid SUBARU programs of any size for scaling and soak runs.
+// The program is built one unit at a time (a straight run of lines or a
+// loop nest), each unit is simulated to record the expected output, then
+// written out and dropped, so multi-GB programs need no more memory than
+// a single unit.
+
+namespace {
+
+const char USAGE[] =
+  "Usage: ./subaruu_gen [options]\n"
+  "  -lines n          stop after about n lines (default 1000)\n"
+  "  -size n[K|M|G]    stop after about n bytes instead\n"
+  "  -density d        share of line numbers used, 0 < d <= 1 (default 1)\n"
+  "  -nesting k        loop nesting depth, 0 to 8 (default 1)\n"
+  "  -iterations n     iterations of every loop (default 3)\n"
+  "  -block n          lines in each loop body (default 40)\n"
+  "  -jumps r          share of body lines that jump forward (default .05)\n"
+  "  -jump-dist name   uniform, geometric or fixed (default geometric)\n"
+  "  -jump-mean n      mean jump distance in lines (default 8)\n"
+  "  -comments r       share of body lines that are REM (default .2)\n"
+  "  -comment-length n characters of REM text (default 40)\n"
+  "  -prints r         share of body lines that PRINT (default .1)\n"
+  "  -seed n           random seed (default 1)\n"
+  "  -max-steps n      give up on the expected output after n lines run\n"
+  "  -o file           program output (default stdout)\n"
+  "  -expected file    where to write the expected output\n";
+
+// The largest line number the tokenizer reads as a single number.
+constexpr std::uint64_t MAX_LINE_NUMBER = 99999990;
+// Loop counters take the last letters, data the first sixteen.
+constexpr int MAX_NESTING = 8;
+constexpr int DATA_VARIABLES = 16;
+constexpr char LOOP_VARIABLES[] = "qrstuvwx";
+
+enum class JumpDistribution { UNIFORM, GEOMETRIC, FIXED };
+
+// Command line switches.
+struct Options {
+        std::uint64_t lines = 1000;
+        std::uint64_t size = 0;
+        double density = 1.0;
+        int nesting = 1;
+        int iterations = 3;
+        int block = 40;
+        double jumps = 0.05;
+        JumpDistribution jump_dist = JumpDistribution::GEOMETRIC;
+        double jump_mean = 8;
+        double comments = 0.2;
+        int comment_length = 40;
+        double prints = 0.1;
+        std::uint64_t seed = 1;
+        std::uint64_t max_steps = 50000000;
+        std::string output;
+        std::string expected;
+};
+
+// What a generated line does; the text is what gets written.
+enum class Kind { REM, PRINT, LET, LOOP_INIT, LOOP_STEP, LOOP_TEST, IF, GOTO };
+enum class Relation { LT, GT, EQ, NE };
+
+struct Line {
+        std::uint64_t number = 0;
+        Kind kind = Kind::REM;
+        int target = 0;     // Assigned variable, or loop counter
+        int left = 0;       // First operand variable
+        int right = 0;      // Second operand variable
+        int constant = 0;   // Added constant, or loop limit
+        Relation relation = Relation::LT;
+        std::size_t jump = 0; // Index of the target line within the unit
+        std::string text;
+};
+
+// Generator state carried from one unit to the next.
+struct State {
+        std::mt19937_64 rng;
+        std::uint64_t next_number = 10;
+        std::uint64_t lines = 0;
+        std::uint64_t bytes = 0;
+        std::uint64_t steps = 0;
+        bool computable = true;
+        int values[26] = {};
+};
+
+char variable(int index) { return static_cast<char>('a' + index); }
+
+/**
+ * parse_size
+ *
+ * @param text A byte count with an optional K, M or G suffix
+ * @return The number of bytes
+ */
+std::uint64_t parse_size(const char* text) {
+    char* end = nullptr;
+    double value = std::strtod(text, &end);
+    switch (*end) {
+        case 'K':
+        case 'k':
+            value *= 1024.0;
+            break;
+        case 'M':
+        case 'm':
+            value *= 1024.0 * 1024.0;
+            break;
+        case 'G':
+        case 'g':
+            value *= 1024.0 * 1024.0 * 1024.0;
+            break;
+        default:
+            break;
+    }
+    return static_cast<std::uint64_t>(value);
+}
+
+/**
+ * parse_options
+ *
+ * @param argc Argument count from main
+ * @param argv Argument vector from main
+ * @param options Filled in from the arguments
+ * @return false on an unknown switch, a missing value or a bad range
+ */
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* name = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char* value = argv[++i];
+        if (std::strcmp(name, "-lines") == 0) {
+            options.lines = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(name, "-size") == 0) {
+            options.size = parse_size(value);
+        } else if (std::strcmp(name, "-density") == 0) {
+            options.density = std::atof(value);
+        } else if (std::strcmp(name, "-nesting") == 0) {
+            options.nesting = std::atoi(value);
+        } else if (std::strcmp(name, "-iterations") == 0) {
+            options.iterations = std::atoi(value);
+        } else if (std::strcmp(name, "-block") == 0) {
+            options.block = std::atoi(value);
+        } else if (std::strcmp(name, "-jumps") == 0) {
+            options.jumps = std::atof(value);
+        } else if (std::strcmp(name, "-jump-dist") == 0) {
+            if (std::strcmp(value, "uniform") == 0) {
+                options.jump_dist = JumpDistribution::UNIFORM;
+            } else if (std::strcmp(value, "geometric") == 0) {
+                options.jump_dist = JumpDistribution::GEOMETRIC;
+            } else if (std::strcmp(value, "fixed") == 0) {
+                options.jump_dist = JumpDistribution::FIXED;
+            } else {
+                return false;
+            }
+        } else if (std::strcmp(name, "-jump-mean") == 0) {
+            options.jump_mean = std::atof(value);
+        } else if (std::strcmp(name, "-comments") == 0) {
+            options.comments = std::atof(value);
+        } else if (std::strcmp(name, "-comment-length") == 0) {
+            options.comment_length = std::atoi(value);
+        } else if (std::strcmp(name, "-prints") == 0) {
+            options.prints = std::atof(value);
+        } else if (std::strcmp(name, "-seed") == 0) {
+            options.seed = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(name, "-max-steps") == 0) {
+            options.max_steps = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(name, "-o") == 0) {
+            options.output = value;
+        } else if (std::strcmp(name, "-expected") == 0) {
+            options.expected = value;
+        } else {
+            return false;
+        }
+    }
+    return options.density > 0 && options.density <= 1 &&
+           options.nesting >= 0 && options.nesting <= MAX_NESTING &&
+           options.iterations > 0 && options.block > 0 &&
+           options.jump_mean >= 1 && options.comment_length >= 0 &&
+           options.jumps + options.comments + options.prints <= 1;
+}
+
+/**
+ * next_line_number
+ *
+ * Skips a geometric number of unused multiples of ten so that, on average,
+ * the requested share of line numbers is taken.
+ *
+ * @param options The generator options
+ * @param state Generator state
+ * @return The next line number
+ * @throws std::runtime_error Once line numbers run out
+ */
+std::uint64_t next_line_number(const Options& options, State& state) {
+    std::uint64_t number = state.next_number;
+    if (options.density < 1) {
+        std::geometric_distribution<std::uint64_t> gap(options.density);
+        number += 10 * gap(state.rng);
+    }
+    if (number > MAX_LINE_NUMBER) {
+        throw std::runtime_error("Ran out of line numbers; use a higher "
+                                 "-density or a smaller program");
+    }
+    state.next_number = number + 10;
+    return number;
+}
+
+/**
+ * jump_distance
+ *
+ * @param options The generator options
+ * @param state Generator state
+ * @return How many lines ahead a jump lands, at least 1
+ */
+std::size_t jump_distance(const Options& options, State& state) {
+    switch (options.jump_dist) {
+        case JumpDistribution::UNIFORM: {
+            std::uniform_int_distribution<std::size_t> distance(
+              1, static_cast<std::size_t>(2 * options.jump_mean - 1));
+            return distance(state.rng);
+        }
+        case JumpDistribution::GEOMETRIC: {
+            std::geometric_distribution<std::size_t> distance(
+              1.0 / options.jump_mean);
+            return 1 + distance(state.rng);
+        }
+        case JumpDistribution::FIXED:
+        default:
+            return static_cast<std::size_t>(options.jump_mean);
+    }
+}
+
+/**
+ * body_line
+ *
+ * Picks a random body line. Jumps only get their target once the whole
+ * body is known.
+ *
+ * @param options The generator options
+ * @param state Generator state
+ * @return The new line, without number or text
+ */
+Line body_line(const Options& options, State& state) {
+    std::uniform_real_distribution<double> pick(0, 1);
+    std::uniform_int_distribution<int> data(0, DATA_VARIABLES - 1);
+    std::uniform_int_distribution<int> constant(0, 9);
+    Line line;
+    line.target = data(state.rng);
+    line.left = data(state.rng);
+    line.right = data(state.rng);
+    line.constant = constant(state.rng);
+
+    const double roll = pick(state.rng);
+    if (roll < options.comments) {
+        line.kind = Kind::REM;
+    } else if (roll < options.comments + options.prints) {
+        line.kind = Kind::PRINT;
+    } else if (roll < options.comments + options.prints + options.jumps) {
+        line.kind = pick(state.rng) < 0.25 ? Kind::GOTO : Kind::IF;
+        line.relation = static_cast<Relation>(state.rng() % 4);
+    } else {
+        line.kind = Kind::LET;
+    }
+    return line;
+}
+
+/**
+ * build_unit
+ *
+ * Builds one unit: a loop nest of the requested depth around a random
+ * body, or just the body when nesting is 0. Forward jumps stay inside the
+ * innermost body, at most landing on the line that closes it.
+ *
+ * @param options The generator options
+ * @param state Generator state
+ * @return The unit's lines, numbered but without text
+ */
+std::vector<Line> build_unit(const Options& options, State& state) {
+    std::vector<Line> lines;
+    std::vector<std::size_t> heads;
+
+    // Opening half of the nest: init each counter, note where its body
+    // starts.
+    for (int level = 0; level < options.nesting; ++level) {
+        Line init;
+        init.kind = Kind::LOOP_INIT;
+        init.target = LOOP_VARIABLES[level] - 'a';
+        lines.push_back(init);
+        heads.push_back(lines.size());
+    }
+
+    const std::size_t body_start = lines.size();
+    for (int n = 0; n < options.block; ++n) {
+        lines.push_back(body_line(options, state));
+    }
+    const std::size_t body_end = lines.size(); // First line after the body
+
+    // Closing half of the nest, innermost loop first.
+    for (int level = options.nesting - 1; level >= 0; --level) {
+        Line step;
+        step.kind = Kind::LOOP_STEP;
+        step.target = LOOP_VARIABLES[level] - 'a';
+        lines.push_back(step);
+        Line test;
+        test.kind = Kind::LOOP_TEST;
+        test.target = step.target;
+        test.constant = options.iterations;
+        test.jump = heads[level];
+        lines.push_back(test);
+    }
+    // Straight runs still need a line after the body for jumps to land on.
+    if (options.nesting == 0) {
+        Line landing;
+        landing.kind = Kind::REM;
+        lines.push_back(landing);
+    }
+
+    for (std::size_t i = body_start; i < body_end; ++i) {
+        if (lines[i].kind == Kind::IF || lines[i].kind == Kind::GOTO) {
+            lines[i].jump =
+              std::min(i + jump_distance(options, state), body_end);
+        }
+    }
+    for (auto& line : lines) {
+        line.number = next_line_number(options, state);
+    }
+    return lines;
+}
+
+/**
+ * render
+ *
+ * Fills in the source text of every line.
+ *
+ * @param options The generator options
+ * @param lines The unit to render
+ * @return void
+ */
+void render(const Options& options, std::vector<Line>& lines) {
+    static const char RELATIONS[][3] = { "<", ">", "=", "<>" };
+    static const char FILLER[] = "the witch of envy whispers in the dark ";
+    for (auto& line : lines) {
+        std::string text = std::to_string(line.number) + " ";
+        switch (line.kind) {
+            case Kind::REM:
+                text += "REM ";
+                for (int i = 0; i < options.comment_length; ++i) {
+                    text += FILLER[i % (sizeof(FILLER) - 1)];
+                }
+                break;
+            case Kind::PRINT:
+                text += "PRINT \"at " + std::to_string(line.number) + "\", ";
+                text += variable(line.left);
+                break;
+            case Kind::LET:
+                text += "LET ";
+                text += variable(line.target);
+                text += " = (";
+                text += variable(line.left);
+                text += " + ";
+                text += variable(line.right);
+                text += ") / 2 + " + std::to_string(line.constant);
+                break;
+            case Kind::LOOP_INIT:
+                text += "LET ";
+                text += variable(line.target);
+                text += " = 0";
+                break;
+            case Kind::LOOP_STEP:
+                text += "LET ";
+                text += variable(line.target);
+                text += " = ";
+                text += variable(line.target);
+                text += " + 1";
+                break;
+            case Kind::LOOP_TEST:
+                text += "IF ";
+                text += variable(line.target);
+                text += " < " + std::to_string(line.constant) + " THEN " +
+                        std::to_string(lines[line.jump].number);
+                break;
+            case Kind::IF:
+                text += "IF ";
+                text += variable(line.left);
+                text += " ";
+                text += RELATIONS[static_cast<int>(line.relation)];
+                text += " ";
+                text += variable(line.right);
+                text += " THEN " + std::to_string(lines[line.jump].number);
+                break;
+            case Kind::GOTO:
+                text += "GOTO " + std::to_string(lines[line.jump].number);
+                break;
+        }
+        line.text = std::move(text);
+    }
+}
+
+/**
+ * holds
+ *
+ * @param relation The comparison to make
+ * @param left Left operand
+ * @param right Right operand
+ * @return Whether the relation holds
+ */
+bool holds(Relation relation, int left, int right) {
+    switch (relation) {
+        case Relation::LT:
+            return left < right;
+        case Relation::GT:
+            return left > right;
+        case Relation::EQ:
+            return left == right;
+        case Relation::NE:
+        default:
+            return left != right;
+    }
+}
+
+/**
+ * simulate
+ *
+ * Runs the unit the way the interpreter would and appends what it prints.
+ * Gives up, marking the output as not computable, once max_steps lines
+ * have been run in total.
+ *
+ * @param options The generator options
+ * @param lines The unit to run
+ * @param state Generator state; variables carry over between units
+ * @param expected Where the printed output goes
+ * @return void
+ */
+void simulate(const Options& options,
+              const std::vector<Line>& lines,
+              State& state,
+              std::ostream& expected) {
+    int* v = state.values;
+    std::size_t pc = 0;
+    while (state.computable && pc < lines.size()) {
+        if (++state.steps > options.max_steps) {
+            state.computable = false;
+            return;
+        }
+        const Line& line = lines[pc++];
+        switch (line.kind) {
+            case Kind::REM:
+                break;
+            case Kind::PRINT:
+                expected << "at " << line.number << " " << v[line.left]
+                         << '\n';
+                break;
+            case Kind::LET:
+                v[line.target] =
+                  (v[line.left] + v[line.right]) / 2 + line.constant;
+                break;
+            case Kind::LOOP_INIT:
+                v[line.target] = 0;
+                break;
+            case Kind::LOOP_STEP:
+                ++v[line.target];
+                break;
+            case Kind::LOOP_TEST:
+                if (v[line.target] < line.constant) {
+                    pc = line.jump;
+                }
+                break;
+            case Kind::IF:
+                if (holds(line.relation, v[line.left], v[line.right])) {
+                    pc = line.jump;
+                }
+                break;
+            case Kind::GOTO:
+                pc = line.jump;
+                break;
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << USAGE;
+        return EXIT_FAILURE;
+    }
+
+    std::ofstream program_file;
+    if (!options.output.empty()) {
+        program_file.open(options.output, std::ios::binary | std::ios::trunc);
+        if (!program_file.is_open()) {
+            std::cerr << "Failed to open file: " << options.output << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+    std::ostream& program = options.output.empty() ? std::cout : program_file;
+
+    // Without a file to record it in, there is no point simulating.
+    std::ofstream expected;
+    State state;
+    state.rng.seed(options.seed);
+    state.computable = !options.expected.empty();
+    if (state.computable) {
+        expected.open(options.expected, std::ios::binary | std::ios::trunc);
+        if (!expected.is_open()) {
+            std::cerr << "Failed to open file: " << options.expected << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    try {
+        program << "REM generated by subaruu_gen, seed " << options.seed
+                << "\n";
+        while (options.size ? state.bytes < options.size
+                            : state.lines < options.lines) {
+            auto lines = build_unit(options, state);
+            render(options, lines);
+            if (state.computable) {
+                simulate(options, lines, state, expected);
+            }
+            for (const auto& line : lines) {
+                program << line.text << '\n';
+                state.bytes += line.text.size() + 1;
+            }
+            state.lines += lines.size();
+        }
+        const std::uint64_t last = next_line_number(options, state);
+        program << last << " PRINT \"done\"\n";
+        expected << "done\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Generator Error: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    if (!options.expected.empty() && !state.computable) {
+        expected.close();
+        std::remove(options.expected.c_str());
+        std::cerr << "Expected output not recorded: more than "
+                  << options.max_steps << " lines would run\n";
+    }
+    std::cerr << state.lines + 2 << " lines, " << state.bytes
+              << " bytes generated\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,199 @@
+#include "workloads.h"
+
+#include <algorithm>
+#include <cmath>
+
+/******************************************************************************/
+
+namespace {
+/**
+ * scaled
+ *
+ * @param base The size at scale 1
+ * @param scale The requested scale
+ * @return base * scale, at least 1
+ */
+std::size_t scaled(std::size_t base, double scale) {
+    return std::max<std::size_t>(
+      1, static_cast<std::size_t>(std::llround(base * scale)));
+}
+
+/**
+ * expression_tree
+ *
+ * Writes a fully parenthesised expression of the given depth. Products
+ * and quotients always take a non-zero leaf on the right, which keeps the
+ * value well inside int and never divides by zero.
+ *
+ * @param out Where to write the expression
+ * @param depth Levels of operators above the leaves
+ * @param counter Cycles through leaves and operators between calls
+ * @return void
+ */
+void expression_tree(std::ostream& out, int depth, std::size_t& counter) {
+    static constexpr const char* LEAVES[] = { "a", "b", "c", "1", "2", "9" };
+    static constexpr char OPERATORS[] = { '+', '-', '*', '+', '-', '/' };
+    if (depth == 0) {
+        out << LEAVES[counter++ % std::size(LEAVES)];
+        return;
+    }
+    const char op = OPERATORS[counter++ % std::size(OPERATORS)];
+    out << '(';
+    expression_tree(out, depth - 1, counter);
+    out << ' ' << op << ' ';
+    if (op == '*' || op == '/') {
+        out << LEAVES[counter++ % std::size(LEAVES)];
+    } else {
+        expression_tree(out, depth - 1, counter);
+    }
+    out << ')';
+}
+} // namespace
+
+/**
+ * generate_loop
+ *
+ * @param out Where to write the program
+ * @param scale 200000 iterations at scale 1
+ * @return Lines executed
+ */
+std::size_t generate_loop(std::ostream& out, double scale) {
+    const std::size_t iterations = scaled(200000, scale);
+    out << "10 LET i = 0\n"
+        << "20 LET i = i + 1\n"
+        << "30 IF i < " << iterations << " THEN 20\n"
+        << "40 PRINT \"i = \", i\n";
+    return 2 + 2 * iterations;
+}
+
+/**
+ * generate_expressions
+ *
+ * @param out Where to write the program
+ * @param scale 2000 passes over 32 depth-6 expressions at scale 1
+ * @return Lines executed
+ */
+std::size_t generate_expressions(std::ostream& out, double scale) {
+    constexpr std::size_t EXPRESSIONS = 32;
+    constexpr int DEPTH = 6;
+    const std::size_t passes = scaled(2000, scale);
+    static constexpr char TARGETS[] = { 'd', 'e', 'f', 'g', 'h' };
+
+    out << "10 LET a = 3\n20 LET b = 5\n30 LET c = 7\n40 LET i = 0\n";
+    std::size_t line = 50;
+    std::size_t counter = 0;
+    for (std::size_t n = 0; n < EXPRESSIONS; ++n, line += 10) {
+        out << line << " LET " << TARGETS[n % std::size(TARGETS)] << " = ";
+        expression_tree(out, DEPTH, counter);
+        out << '\n';
+    }
+    out << line << " LET i = i + 1\n"
+        << line + 10 << " IF i < " << passes << " THEN 50\n"
+        << line + 20 << " PRINT \"d = \", d\n";
+    return 5 + passes * (EXPRESSIONS + 2);
+}
+
+/**
+ * generate_report
+ *
+ * @param out Where to write the program
+ * @param scale 20000 report rows at scale 1
+ * @return Lines executed
+ */
+std::size_t generate_report(std::ostream& out, double scale) {
+    const std::size_t rows = scaled(20000, scale);
+    out << "10 LET i = 0\n"
+        << "20 LET t = 0\n"
+        << "30 PRINT \"Report row \", i, \" running total \", t\n"
+        << "40 PRINT \"  detail: \", i * 3, \" / \", t - i\n"
+        << "50 LET t = t + 3\n"
+        << "60 LET i = i + 1\n"
+        << "70 IF i < " << rows << " THEN 30\n"
+        << "80 PRINT \"Total \", t\n";
+    return 3 + 5 * rows;
+}
+
+/**
+ * generate_comments
+ *
+ * @param out Where to write the program
+ * @param scale 1000000 lines at scale 1, nine in ten of them REM
+ * @return Lines executed
+ */
+std::size_t generate_comments(std::ostream& out, double scale) {
+    const std::size_t lines = scaled(1000000, scale);
+    for (std::size_t n = 1; n < lines; ++n) {
+        out << n * 10;
+        if (n % 10 == 0) {
+            out << " LET a = a + 1\n";
+        } else {
+            out << " REM the witch's gospel, page " << n << "\n";
+        }
+    }
+    out << lines * 10 << " PRINT \"a = \", a\n";
+    return lines;
+}
+
+/**
+ * generate_state_machine
+ *
+ * The dispatcher is a chain of IF s = k THEN <state k> lines; every state
+ * counts a transition, picks the next state and jumps back to the
+ * dispatcher until the transition budget is spent.
+ *
+ * @param out Where to write the program
+ * @param scale 20000 transitions between 32 states at scale 1
+ * @return Lines executed
+ */
+std::size_t generate_state_machine(std::ostream& out, double scale) {
+    constexpr std::size_t STATES = 32;
+    constexpr std::size_t STATE_BASE = 1000;
+    constexpr std::size_t STATE_SIZE = 100;
+    const std::size_t transitions = scaled(20000, scale);
+    const std::size_t end_line = STATE_BASE + STATE_SIZE * STATES;
+    auto next_state = [](std::size_t state) {
+        return (state * 7 + 3) % STATES;
+    };
+
+    out << "10 LET s = 0\n20 LET n = 0\n";
+    for (std::size_t state = 0; state < STATES; ++state) {
+        out << 30 + state * 10 << " IF s = " << state << " THEN "
+            << STATE_BASE + STATE_SIZE * state << '\n';
+    }
+    for (std::size_t state = 0; state < STATES; ++state) {
+        const std::size_t base = STATE_BASE + STATE_SIZE * state;
+        out << base << " LET n = n + 1\n"
+            << base + 10 << " LET s = " << next_state(state) << '\n'
+            << base + 20 << " IF n < " << transitions << " THEN 30\n"
+            << base + 30 << " GOTO " << end_line << '\n';
+    }
+    out << end_line << " PRINT \"transitions \", n\n";
+
+    // Walk the machine to count the lines it executes.
+    std::size_t executed = 2;
+    std::size_t state = 0;
+    for (std::size_t n = 1; n <= transitions; ++n) {
+        executed += (state + 1) + 3;
+        state = next_state(state);
+    }
+    return executed + 2;
+}
+
+/**
+ * workloads
+ *
+ * @param void
+ * @return Every workload, in the order they are run
+ */
+const std::vector<Workload>& workloads() {
+    static const std::vector<Workload> all = {
+        { "loop", "tight counted loop", &generate_loop },
+        { "expressions", "deep expression trees", &generate_expressions },
+        { "report", "PRINT-heavy report", &generate_report },
+        { "comments", "1M-line REM-heavy file", &generate_comments },
+        { "state_machine",
+          "jump-heavy state machine",
+          &generate_state_machine },
+    };
+    return all;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+// A generated benchmark program. generate() writes the program for the
+// given scale and returns how many lines it executes when run.
+struct Workload {
+        std::string_view name;
+        std::string_view description;
+        std::size_t (*generate)(std::ostream& out, double scale);
+};
+
+// Tight counted loop: LET i = i + 1 / IF i < n THEN back.
+std::size_t generate_loop(std::ostream& out, double scale);
+// A loop over lines that each evaluate a deep expression tree.
+std::size_t generate_expressions(std::ostream& out, double scale);
+// A report that prints several formatted lines per iteration.
+std::size_t generate_report(std::ostream& out, double scale);
+// One million lines, mostly REM, run straight through once.
+std::size_t generate_comments(std::ostream& out, double scale);
+// A state machine dispatched through an IF chain and GOTO.
+std::size_t generate_state_machine(std::ostream& out, double scale);
+
+// Every workload, in the order they are run.
+const std::vector<Workload>& workloads();
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "config.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Storage for DIM arrays. Each array is one contiguous run of zeroed ints
+// carved off the end of a block of SUBARUU_ARENA_BLOCK, so a program's
+// arrays sit next to each other and dimensioning one is a bump of an
+// offset rather than a trip to the heap. Nothing is freed until the arena
+// goes; an array too big for a block gets a block of its own.
+class Arena {
+    public:
+        Arena() = default;
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // count zeroed ints that stay put as long as the arena
+        [[nodiscard]] int* allocate(std::size_t count);
+
+    private:
+        std::vector<std::unique_ptr<int[]>> blocks_; // The last is filling
+        std::vector<std::unique_ptr<int[]>> large_;  // One array each
+        std::size_t used_ = 0; // Of the last block
+};
@@ -1,9 +1,13 @@
 #pragma once
 
-#include <iostream>
+#include "trace_log.h"
 
-#ifdef DEBUG_MODE
-#define DEBUG_LOG(x) std::cerr << "DEBUG: " << x << std::endl
-#else
-#define DEBUG_LOG(x)
-#endif
+// Writes a record to the trace log when its category is enabled. A
+// disabled category costs one test of a global mask; nothing is formatted.
+#define TRACE_LOG(category, x)                                                 \
+    do {                                                                       \
+        if (trace_enabled(TraceCategory::category)) [[unlikely]] {             \
+            trace_log().begin(TraceCategory::category) << x;                   \
+            trace_log().end();                                                 \
+        }                                                                      \
+    } while (0)
@@ -10,7 +10,60 @@ constexpr char SUBARUU_EXTENSION_LITERAL[] = "subaru";
 constexpr std::size_t SUBARUU_STRING_LITERAL = 50;
 constexpr std::size_t SUBARUU_NUMBER_LITERAL = 8;
 
+// The size of the windows -stream reads a program in. Lines are never
+// split across windows; a longer line makes its window grow to fit it.
+constexpr std::size_t SUBARUU_STREAM_WINDOW = 1 << 20;
+
+// The size of the windows -lazy reads a program in: small, so that the
+// first statement runs as soon as its line has been read.
+constexpr std::size_t SUBARUU_LAZY_WINDOW = 1 << 16;
+
+// Loaded programs of at least two chunks this size are split into chunks
+// at newlines and lexed on one thread per core.
+constexpr std::size_t SUBARUU_LEX_CHUNK = 8 << 20;
+
 // Interpreter constants
 constexpr std::size_t SUBARUU_MAX_VARIABLES = 26;
 constexpr int SUBARUU_DIVIDE_BY_ZERO_RESULT = 0;
 constexpr bool SUBARUU_TERMINATE_ON_DIV_ZERO = false;
+
+// Line numbers that are multiples of the stride are looked up by indexing
+// a slot per multiple, as long as there are no more than this many slots
+// for each line; sparser programs are binary searched instead.
+constexpr int SUBARUU_LINE_STRIDE = 10;
+constexpr std::size_t SUBARUU_LINE_SLOTS_PER_LINE = 4;
+
+// How many computed jump targets a program without slots remembers.
+constexpr std::size_t SUBARUU_LINE_CACHE = 64;
+
+// How deep GOSUB calls may nest. The return stack is this size from the
+// start, so a call never allocates.
+constexpr std::size_t SUBARUU_GOSUB_DEPTH = 256;
+
+// How deep FOR loops may nest, likewise allocated up front.
+constexpr std::size_t SUBARUU_FOR_DEPTH = 64;
+
+// How deep WHILE loops may nest in a program not loaded whole, whose
+// loops are found as they run rather than linked at load.
+constexpr std::size_t SUBARUU_WHILE_DEPTH = 64;
+
+// DIM arrays are carved out of blocks of this many ints, and may have at
+// most SUBARUU_ARRAY_MAX elements each.
+constexpr std::size_t SUBARUU_ARENA_BLOCK = 1 << 14;
+constexpr std::size_t SUBARUU_ARRAY_MAX = 1 << 24;
+
+// Where -profile writes its machine-readable results.
+constexpr char SUBARUU_PROFILE_OUTPUT[] = "subaruu-profile.json";
+
+// CPU time between two -sample samples, and where they are written.
+constexpr long SUBARUU_SAMPLE_INTERVAL_US = 1000;
+constexpr char SUBARUU_SAMPLE_OUTPUT[] = "subaruu-samples.folded";
+
+// Where -perfcounters writes its machine-readable results.
+constexpr char SUBARUU_PERF_OUTPUT[] = "subaruu-perf.json";
+
+// Where -stats writes its machine-readable counters.
+constexpr char SUBARUU_STATS_OUTPUT[] = "subaruu-stats.json";
+
+// Most events -trace writes before dropping the rest; about 100 MB of JSON.
+constexpr unsigned long long SUBARUU_TRACE_MAX_EVENTS = 1000000;
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+
+// A read position in a buffer that ends with a readable sentinel: the '\0'
+// after a std::string's characters for the lexer, the EOF_TOKEN that ends a
+// token array for the interpreter. Loops test the element they read rather
+// than a bound, and being header-only it inlines into both of them.
+template <typename T>
+class Cursor {
+    public:
+        Cursor() = default;
+        // end points at the sentinel
+        Cursor(const T* begin, const T* end) noexcept
+          : begin_(begin)
+          , pos_(begin)
+          , end_(end) {}
+
+        [[nodiscard]] const T& operator*() const noexcept { return *pos_; }
+        [[nodiscard]] const T* operator->() const noexcept { return pos_; }
+
+        // The element after the current one; the sentinel stays put
+        [[nodiscard]] const T& peek() const noexcept {
+            return pos_[pos_ != end_];
+        }
+
+        // Moves on one element, staying on the sentinel once there
+        void next() noexcept { pos_ += pos_ != end_; }
+        // Moves on one element; the current one must not be the sentinel
+        void advance() noexcept { ++pos_; }
+
+        [[nodiscard]] bool at_end() const noexcept { return pos_ == end_; }
+        [[nodiscard]] std::size_t offset() const noexcept {
+            return static_cast<std::size_t>(pos_ - begin_);
+        }
+        [[nodiscard]] std::size_t size() const noexcept {
+            return static_cast<std::size_t>(end_ - begin_);
+        }
+        void seek(std::size_t offset) noexcept { pos_ = begin_ + offset; }
+        void reset() noexcept { pos_ = begin_; }
+
+    private:
+        const T* begin_ = nullptr;
+        const T* pos_ = nullptr;
+        const T* end_ = nullptr;
+};
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <fstream>
 #include <string>
 #include <string_view>
@@ -8,7 +9,9 @@ class IO {
         using iterator = std::string::iterator;
         using const_iterator = std::string::const_iterator;
 
-        explicit IO(std::string_view filename); // Can throw
+        // Loads the whole file, or streams it window bytes at a time
+        explicit IO(std::string_view filename,
+                    std::size_t window = 0); // Can throw
         ~IO() noexcept;
 
         // Iterator operations
@@ -21,6 +24,14 @@ class IO {
             return content_.end();
         }
 
+        // The whole content; data()[size()] is always a readable '\0'
+        [[nodiscard]] const char* data() const noexcept {
+            return content_.data();
+        }
+        [[nodiscard]] std::size_t size() const noexcept {
+            return content_.size();
+        }
+
         // Get current position
         [[nodiscard]] iterator position() noexcept { return current_pos_; }
         [[nodiscard]] const_iterator position() const noexcept {
@@ -72,6 +83,14 @@ class IO {
             return filename_;
         }
 
+        // Streaming: content_ holds the whole lines of one window
+        [[nodiscard]] bool streaming() const noexcept { return window_ != 0; }
+        [[nodiscard]] std::uint64_t window_offset() const noexcept {
+            return window_offset_;
+        }
+        bool next_window();                     // Can throw
+        bool seek_window(std::uint64_t offset); // Can throw
+
     private:
         // Loads entire file into content_
         void load_file();
@@ -79,6 +98,12 @@ class IO {
         std::string content_;
         iterator current_pos_;
 
+        // Streaming state; window_ is 0 when the whole file is loaded
+        std::ifstream stream_;
+        std::size_t window_ = 0;
+        std::string carry_; // Read past the last whole line of content_
+        std::uint64_t window_offset_ = 0; // File offset of content_[0]
+
         IO(const IO&) = delete;
         IO& operator=(const IO&) = delete;
 };
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "config.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// The numbered lines of a program, sorted by number. Each entry holds the
+// index of the line's number token, where a jump to it goes.
+// When the numbers are dense multiples of SUBARUU_LINE_STRIDE a line is
+// found by indexing a slot array with its number; otherwise by binary
+// search, and targets computed at run time go through a small cache
+// first. A number used twice finds its first line, as a rescan from the
+// top would.
+class LineTable {
+    public:
+        static constexpr std::uint32_t NONE = UINT32_MAX;
+
+        struct Entry {
+                std::int32_t line;
+                std::uint32_t token; // Index of the line number token
+        };
+
+        LineTable() = default;
+
+        // Lines are added in program order, and take effect at index()
+        void add(int line, std::uint32_t token) {
+            pending_.push_back({ line, token });
+        }
+        void index();
+        void clear();
+
+        // The entry of a line, or NONE
+        [[nodiscard]] std::uint32_t find(int line) const noexcept {
+            if (dense_) {
+                const auto offset = static_cast<std::uint32_t>(line) -
+                                    static_cast<std::uint32_t>(base_);
+                const std::uint32_t slot = offset / SUBARUU_LINE_STRIDE;
+                return offset % SUBARUU_LINE_STRIDE == 0 &&
+                           slot < slots_.size()
+                         ? slots_[slot]
+                         : NONE;
+            }
+            return search(line);
+        }
+        // find() for a line computed at run time. Without slots, the lines
+        // looked up last, found or not, are remembered by number.
+        [[nodiscard]] std::uint32_t lookup(int line) noexcept {
+            if (dense_) {
+                return find(line);
+            }
+            Cached& cached =
+              cache_[static_cast<std::uint32_t>(line) % cache_.size()];
+            if (cached.line != line || cached.entry == UNCACHED) {
+                cached = { line, search(line) };
+            }
+            return cached.entry;
+        }
+        [[nodiscard]] const Entry& operator[](std::uint32_t entry) const {
+            return entries_[entry];
+        }
+
+        [[nodiscard]] std::size_t size() const noexcept {
+            return entries_.size();
+        }
+        [[nodiscard]] bool empty() const noexcept { return entries_.empty(); }
+        [[nodiscard]] bool dense() const noexcept { return dense_; }
+        // Every line number, in program order
+        [[nodiscard]] std::vector<int> numbers() const;
+
+    private:
+        static constexpr std::uint32_t UNCACHED = NONE - 1;
+
+        struct Cached {
+                std::int32_t line;
+                std::uint32_t entry; // Possibly NONE
+        };
+
+        std::uint32_t search(int line) const noexcept;
+        bool append_sorted();
+        void rebuild();
+        void index_slots();
+        bool add_slot(std::uint32_t entry);
+
+        std::vector<Entry> entries_;     // Sorted by line, then token
+        std::vector<Entry> pending_;     // Added since the last index()
+        std::vector<std::uint32_t> slots_; // By (line - base_) / stride
+        std::int32_t base_ = 0;
+        bool dense_ = false;
+        std::array<Cached, SUBARUU_LINE_CACHE> cache_ = uncached();
+
+        static std::array<Cached, SUBARUU_LINE_CACHE> uncached() noexcept {
+            std::array<Cached, SUBARUU_LINE_CACHE> cache;
+            cache.fill({ 0, UNCACHED });
+            return cache;
+        }
+};
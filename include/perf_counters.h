@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Per-line hardware counters read through perf_event_open(2). The events
+// are opened as one group so a single read() returns all of them; events
+// the machine lacks are left out, and when none can be opened (no PMU,
+// perf_event_paranoid, seccomp) open() fails and error() says why.
+class PerfCounters {
+    public:
+        enum Event {
+            CYCLES,
+            INSTRUCTIONS,
+            BRANCH_MISSES,
+            CACHE_MISSES,
+            EVENT_COUNT
+        };
+
+        using Values = std::array<std::uint64_t, EVENT_COUNT>;
+
+        struct LineCounts {
+                std::uint64_t hits = 0;
+                Values events{};
+        };
+
+        using LineEntry = std::pair<int, LineCounts>;
+
+        PerfCounters() = default;
+        ~PerfCounters();
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        // Opens the counters for the calling thread; false if denied
+        bool open();
+        void close() noexcept;
+        [[nodiscard]] bool available() const noexcept { return leader_ >= 0; }
+        [[nodiscard]] bool supported(Event event) const noexcept {
+            return slots_[event] >= 0;
+        }
+        [[nodiscard]] const std::string& error() const noexcept {
+            return error_;
+        }
+        [[nodiscard]] static const char* event_name(Event event) noexcept;
+
+        // Pre-creates an entry for every known line number
+        void seed(const std::vector<int>& lines);
+
+        // Charges the counter deltas since the last call to the running
+        // line and starts counting for the given one
+        void enter(int line);
+        void finish() noexcept;
+
+        // Results
+        [[nodiscard]] const std::unordered_map<int, LineCounts>&
+        lines() const noexcept {
+            return lines_;
+        }
+        [[nodiscard]] std::vector<LineEntry> sorted() const;
+        [[nodiscard]] LineCounts totals() const noexcept;
+        void report(std::ostream& out, std::size_t limit = 20) const;
+        void write(std::string_view path) const; // Can throw
+
+    private:
+        bool read(Values& values) const noexcept;
+        void charge(const Values& now) noexcept;
+
+        int leader_ = -1;
+        std::array<int, EVENT_COUNT> fds_{ -1, -1, -1, -1 };
+        // Position of each event in a group read, -1 if it is not counted
+        std::array<int, EVENT_COUNT> slots_{ -1, -1, -1, -1 };
+        int opened_ = 0;
+        std::unordered_map<int, LineCounts> lines_;
+        LineCounts* current_ = nullptr;
+        Values last_{};
+        std::string error_;
+};
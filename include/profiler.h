@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Reads the time stamp counter, or a steady clock tick where there is none.
+inline std::uint64_t read_cycles() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(
+      std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+class Profiler {
+    public:
+        struct LineStats {
+                std::uint64_t hits = 0;
+                std::uint64_t cycles = 0;
+        };
+
+        using LineEntry = std::pair<int, LineStats>;
+
+        Profiler() = default;
+
+        // Pre-creates an entry for every known line number
+        void seed(const std::vector<int>& lines);
+
+        // Closes the running interval and starts one for the given line
+        void enter(int line) {
+            const std::uint64_t now = read_cycles();
+            if (current_) {
+                current_->cycles += now - last_;
+            }
+            current_ = &lines_[line];
+            ++current_->hits;
+            last_ = now;
+        }
+        void finish() noexcept;
+
+        // Results
+        [[nodiscard]] const std::unordered_map<int, LineStats>&
+        lines() const noexcept {
+            return lines_;
+        }
+        [[nodiscard]] std::vector<LineEntry> sorted() const;
+        [[nodiscard]] std::uint64_t total_cycles() const noexcept;
+        void report(std::ostream& out, std::size_t limit = 20) const;
+        void write(std::string_view path) const; // Can throw
+
+    private:
+        std::unordered_map<int, LineStats> lines_;
+        LineStats* current_ = nullptr;
+        std::uint64_t last_ = 0;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+// Statistical profiler: SIGPROF fires on a CPU-time interval and the
+// handler records whatever line the interpreter is on.
+class Sampler {
+    public:
+        explicit Sampler(const std::atomic<int>& line,
+                         std::chrono::microseconds interval);
+        ~Sampler();
+
+        void start(); // Can throw
+        void stop() noexcept;
+        [[nodiscard]] bool running() const noexcept { return running_; }
+
+        // Results, complete once stop() has returned
+        [[nodiscard]] std::map<int, std::uint64_t> histogram() const;
+        [[nodiscard]] std::uint64_t samples() const;
+        [[nodiscard]] std::uint64_t dropped() const noexcept {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+        void report(std::ostream& out, std::size_t limit = 20) const;
+        void write_folded(std::string_view path,
+                          std::string_view root) const; // Can throw
+
+    private:
+        // Single producer (the signal handler), single consumer (drain)
+        static constexpr std::size_t RING_SIZE = 1 << 16;
+        static_assert((RING_SIZE & (RING_SIZE - 1)) == 0);
+        static_assert(std::atomic<int>::is_always_lock_free);
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+        static void on_signal(int signo);
+        void record() noexcept;
+        void drain();
+        void drop_rest() noexcept;
+        void drain_loop() noexcept;
+
+        const std::atomic<int>& line_;
+        std::chrono::microseconds interval_;
+        std::array<int, RING_SIZE> ring_{};
+        std::atomic<std::uint64_t> head_{ 0 };
+        std::atomic<std::uint64_t> tail_{ 0 };
+        std::atomic<std::uint64_t> dropped_{ 0 };
+        std::atomic<bool> running_{ false };
+
+        mutable std::mutex histogram_mutex_;
+        std::map<int, std::uint64_t> histogram_;
+        std::thread drainer_;
+
+        Sampler(const Sampler&) = delete;
+        Sampler& operator=(const Sampler&) = delete;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+
+// Counters the interpreter keeps on every run. Each one is a plain
+// increment on a path that already does far more work, so they are never
+// switched off; -stats only decides whether they are reported.
+struct Stats {
+        enum Statement {
+            REM,
+            PRINT,
+            IF,
+            GOTO,
+            LET,
+            ON,
+            GOSUB,
+            RETURN,
+            FOR,
+            NEXT,
+            WHILE,
+            WEND,
+            DIM,
+            STATEMENT_KINDS
+        };
+
+        // Lexing. Tokenizer::lex() fills the token array, and each window
+        // it refills when streaming adds to the count.
+        std::uint64_t tokens_lexed = 0;
+        std::uint64_t tokenizer_resets = 0; // Rewinds to the first token
+
+        // Execution
+        std::array<std::uint64_t, STATEMENT_KINDS> statements{};
+        std::uint64_t jumps = 0;          // Taken IFs, GOTOs, loop back-edges
+        // Walked by SUBARUU::skip_loop() to the end of a loop that runs no
+        // times, in a program whose loops were not linked at load
+        std::uint64_t tokens_skipped = 0;
+
+        // Output
+        std::uint64_t output_bytes = 0;
+        std::uint64_t output_flushes = 0;
+
+        [[nodiscard]] static const char*
+        statement_name(Statement kind) noexcept;
+        [[nodiscard]] std::uint64_t total_statements() const noexcept;
+
+        void report(std::ostream& out) const;
+        void write_json(std::ostream& out) const;
+        void write(std::string_view path) const; // Can throw
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <ios>
+
+// Puts a stream's format flags and precision back as they were when it goes
+// out of scope, so a report can print with std::fixed, a precision and its
+// own alignment without leaving them on the caller's stream.
+class StreamFormat {
+    public:
+        explicit StreamFormat(std::ios_base& stream)
+          : stream_(stream)
+          , flags_(stream.flags())
+          , precision_(stream.precision()) {}
+        ~StreamFormat() {
+            stream_.flags(flags_);
+            stream_.precision(precision_);
+        }
+        StreamFormat(const StreamFormat&) = delete;
+        StreamFormat& operator=(const StreamFormat&) = delete;
+
+    private:
+        std::ios_base& stream_;
+        std::ios_base::fmtflags flags_;
+        std::streamsize precision_;
+};
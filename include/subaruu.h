@@ -1,34 +1,86 @@
 #pragma once
 
+#include "arena.h"
 #include "config.h"
+#include "line_table.h"
+#include "perf_counters.h"
+#include "profiler.h"
+#include "sampler.h"
+#include "stats.h"
 #include "tokenizer.h"
+#include "tracer.h"
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <string_view>
-#include <unordered_map>
 
 class SUBARUU {
     public:
-        explicit SUBARUU(std::string_view source);
+        // A program loaded lazily starts at once and is read as it runs;
+        // one streamed can be larger than memory. A window of 0 is the
+        // loading's default.
+        explicit SUBARUU(
+          std::string_view source,
+          Tokenizer::Loading loading = Tokenizer::Loading::WHOLE,
+          std::size_t window = 0);
         ~SUBARUU() = default;
 
-        void run();
+        void load();
+        void run(); // Can throw
+        bool try_run();
         std::string get_token_string(Tokenizer::TokenType token) const;
         bool finished() const;
 
-        void log_found_line_numbers(
-          const std::unordered_map<int, bool>& found_lines);
+        // The first error the program ran into, empty if none
+        const std::string& error() const { return error_; }
+        bool failed() const { return !error_.empty(); }
+
+        // Per-line profiling
+        void enable_profiler();
+        const Profiler* profiler() const { return profiler_.get(); }
+
+        // Statistical sampling of the current line
+        void enable_sampler(std::chrono::microseconds interval =
+                              std::chrono::microseconds(
+                                SUBARUU_SAMPLE_INTERVAL_US));
+        const Sampler* sampler() const { return sampler_.get(); }
+
+        // Hardware counters per line; false when the kernel denies them
+        bool enable_perf_counters();
+        const PerfCounters* perf_counters() const {
+            return perf_counters_.get();
+        }
+
+        // Trace-event timeline of load, line blocks and output flushes
+        void enable_tracer(std::string_view path,
+                           std::uint64_t sample_every = 1,
+                           std::uint64_t max_events =
+                             SUBARUU_TRACE_MAX_EVENTS);
+        const Tracer* tracer() const { return tracer_.get(); }
+
+        // Interpreter counters, always kept
+        Stats stats() const;
+
+        void log_found_line_numbers(const LineTable& found_lines);
         void log_available_lines(int target_line);
 
     private:
+        // Main loop, wrapped by run()
+        void execute();
+        void stop_profiling() noexcept;
+
         // Token processing
         void accept(Tokenizer::TokenType expectedToken);
+        void end_statement();
 
         // Expression parsing
         int expression();
         int term();
         int factor();
         int relation();
+        int* element(int slot, std::size_t at);
 
         // Statement handling
         void statement();
@@ -36,29 +88,95 @@ class SUBARUU {
         void let_statement();
         void if_statement();
         void goto_statement();
+        void on_statement();
+        void gosub_statement();
+        void return_statement();
+        void for_statement();
+        void next_statement();
+        void while_statement();
+        void wend_statement();
+        void dim_statement();
+        bool skip_loop(Tokenizer::TokenType open, Tokenizer::TokenType close);
         void print_statement();
 
+        // Output
+        void write_output(std::string_view text);
+        void write_output(int value);
+        void end_output_line();
+
         // Line number management
-        void find_linenum(int linenum);
-        void jump_linenum(int linenum);
         void build_line_map();
-        bool find_target_line(int line_number);
+        void map_lines();
+        void link();
+        void link_list(std::size_t go);
+        void link_loop(std::size_t loop, std::size_t close);
+        std::size_t while_head(std::size_t loop) const;
+        bool link_target(std::size_t target);
+        bool discover(int line_number);
+        void jump_to_line(int line_number, std::size_t target);
+        void jump_to(std::uint32_t address);
+        void restore(const Tokenizer::Mark& mark);
+        void enter_line(int line) {
+            current_line_.store(line, std::memory_order_relaxed);
+            if (line_hooks_) [[unlikely]] {
+                run_line_hooks(line);
+            }
+        }
+        void run_line_hooks(int line);
+        void jumped();
+        void rewind();
+        bool next_window();
+        void stream_jump(int line_number, std::size_t target);
 
         // Aids
-        bool is_valid_line_number(int num) const;
         bool is_line_number() const;
         bool is_statement_end(Tokenizer::TokenType token) const;
 
         // Error handling
         enum ErrorCode { E_ERROR = 1, E_WARNING };
+        std::string locate(const std::string& message,
+                           Tokenizer::Location where) const;
         void dprintf(const std::string& message, int errorCode);
+        void dprintf(const std::string& message,
+                     int errorCode,
+                     Tokenizer::Location where);
         int safe_divide(int numerator, int denominator);
 
         // Member variables
         std::unique_ptr<Tokenizer> tokenizer_;
-        std::unordered_map<char, int> variables_;
-        std::unordered_map<int, bool> line_positions_;
+        Cursor<Tokenizer::Token> cursor_; // Into tokenizer_'s token array
+        std::array<int, SUBARUU_MAX_VARIABLES> variables_; // By slot, a-z
+        // The array DIM gave a variable, apart from its number
+        struct Array {
+                int* data;          // In arena_
+                std::uint32_t size; // 0 until dimensioned
+        };
+        Arena arena_;
+        std::array<Array, SUBARUU_MAX_VARIABLES> arrays_; // By slot, a-z
+        std::array<Tokenizer::Mark, SUBARUU_GOSUB_DEPTH> returns_;
+        std::size_t gosub_depth_; // Return addresses in returns_
+        // A FOR loop that is running
+        struct Loop {
+                int slot; // Of the counter variable
+                int limit;
+                int step;
+                Tokenizer::Mark body; // The statement after the FOR
+        };
+        std::array<Loop, SUBARUU_FOR_DEPTH> loops_;
+        std::size_t loop_depth_; // Running loops in loops_
+        // Where each running WHILE loop starts, for loops not linked
+        std::array<Tokenizer::Mark, SUBARUU_WHILE_DEPTH> whiles_;
+        std::size_t while_depth_; // Running loops in whiles_
+        LineTable line_table_;
+        std::size_t lines_mapped_; // Tokenizer lines in line_table_
+        std::unique_ptr<Profiler> profiler_;
+        std::unique_ptr<Sampler> sampler_;
+        std::unique_ptr<PerfCounters> perf_counters_;
+        std::unique_ptr<Tracer> tracer_;
+        Stats stats_;
+        std::string error_;
+        bool loaded_;
+        bool line_hooks_; // Any of profiler_, perf_counters_, tracer_
         bool execution_finished_;
-        bool skip_to_line_;
-        int target_line_;
+        std::atomic<int> current_line_;
 };
@@ -1,21 +1,35 @@
 #pragma once
 
 #include "config.h"
+#include "cursor.h"
 #include "io.h"
 
-#include <memory>
+#include <cstdint>
+#include <cstdio>
 #include <string>
 #include <string_view>
-#include <variant>
 #include <vector>
 
 class Tokenizer {
     public:
-        // Constructor/Destructor
-        explicit Tokenizer(std::string_view source);
+        // How the source is read. WHOLE loads and lexes it all up front;
+        // a source of at least two lex_chunk bytes is lexed in chunks of
+        // that size on lex_threads threads, 0 for one per core. LAZY reads
+        // and lexes it a window at a time as it is reached, keeping every
+        // token. STREAM does too, but keeps only the current window's.
+        enum class Loading : std::uint8_t { WHOLE, LAZY, STREAM };
+
+        // Constructor/Destructor; a window of 0 is the loading's default
+        explicit Tokenizer(std::string_view source,
+                           Loading loading = Loading::WHOLE,
+                           std::size_t window = 0,
+                           std::size_t lex_chunk = SUBARUU_LEX_CHUNK,
+                           unsigned lex_threads = 0);
         ~Tokenizer();
+        Tokenizer(const Tokenizer&) = delete;
+        Tokenizer& operator=(const Tokenizer&) = delete;
 
-        enum class TokenType {
+        enum class TokenType : std::uint8_t {
             ERROR = 1,
             EOF_TOKEN,
             NUMBER,
@@ -38,51 +52,215 @@ class Tokenizer {
             PRINT,
             REM,
             GOTO,
+            ON,
+            GOSUB,
+            RETURN,
+            FOR,
+            TO,
+            STEP,
+            NEXT,
+            WHILE,
+            WEND,
+            DIM,
             LEFT_PAREN,
             RIGHT_PAREN,
+            COLON,
             EOL
         };
 
         struct KeywordToken {
-                std::string keyword;
+                std::string_view keyword; // Upper case
                 TokenType token;
         };
 
-        using TokenData = std::variant<std::monostate, std::string, int, char>;
+        // A lexed token, packed so that eight share a cache line. The
+        // value is the number of a NUMBER, the variable slot (0-25) of a
+        // LETTER or the literal pool index of a STRING; a LINKED NUMBER
+        // holds the index of the line number token it jumps to instead,
+        // the LINKED GOTO of an ON statement the number of targets, a
+        // LINKED FOR or WHILE the index of the end of the NEXT or WEND that
+        // closes it, and a LINKED WEND the index its WHILE's line starts at.
+        // Where the token came from is kept apart, see location().
+        struct Token {
+                TokenType type;
+                std::uint8_t flags; // LINE_START, LINKED
+                std::uint16_t spare;
+                std::int32_t value;
+        };
+
+        // Where a token starts in the source, both counted from 1
+        struct Location {
+                std::uint32_t line;
+                std::uint32_t column;
+        };
+
+        // The token is the first one on its source line
+        static constexpr std::uint8_t LINE_START = 1;
+        // The jump target has been resolved, see link()
+        static constexpr std::uint8_t LINKED = 2;
 
         // Token operations
-        TokenType current_token() const { return current_token_; }
+        TokenType current_token() const { return cursor_->type; }
+        const Token& token() const { return *cursor_; }
         void reset();
-        void reset(TokenType to);
         bool finished() const;
         void next_token();
 
         // Line detection
-        bool is_line_number();
-        char peek_char();
-        void skip_char();
+        bool is_line_number() const;
         void skip_to_eol();
 
         // Token data access
         std::string_view token_to_string(TokenType token) const;
-        const TokenData& get_token_data() const;
         int variable_num() const;
         std::string_view get_string() const;
         int get_num() const;
 
+        // The whole program, or the current window of a streamed one,
+        // ending with an EOF_TOKEN
+        const std::vector<Token>& tokens() const { return tokens_; }
+        // A cursor at the first token, for the interpreter to run on
+        Cursor<Token> begin() const {
+            return Cursor<Token>(tokens_.data(), &tokens_.back());
+        }
+        // A cursor at the current token
+        Cursor<Token> cursor() const { return cursor_; }
+        // The text of the STRING token with the given value
+        std::string_view literal(std::int32_t index) const;
+        // Resolves the jump target NUMBER at index token to the index of
+        // the line number token it names, gives an ON statement's GOTO
+        // the number of targets in its list, or a loop where it ends or,
+        // for a WEND, starts
+        void link(std::size_t token, std::uint32_t value);
+
+        // A line that starts with a line number
+        struct NumberedLine {
+                std::int32_t line;
+                std::uint32_t token;  // Index of the line number token
+                std::uint64_t offset; // Where the line starts in the source
+        };
+        // The numbered lines of the program, or of the current window, in
+        // source order
+        const std::vector<NumberedLine>& lines() const { return lines_; }
+
+        // Windows. When streaming, the token array holds the whole lines
+        // of one window and is replaced by the next one's at its
+        // EOF_TOKEN; every window after the first ends the ones before
+        // it. When loading lazily, the next window's tokens take the
+        // EOF_TOKEN's place instead.
+        Loading loading() const { return loading_; }
+        bool streaming() const { return loading_ == Loading::STREAM; }
+        bool next_window(); // Can throw
+        // Moves to the numbered line in the current window or, through
+        // the line index, in any window lexed before
+        bool find_line(int line); // Can throw
+        // Reads on through the windows not lexed yet to the numbered line
+        bool scan_to_line(int line); // Can throw
+
+        // A position to come back to, such as a GOSUB's return address.
+        // Loaded programs keep the token index; streamed ones the line it
+        // is on, so the window can be read again once it is replaced.
+        struct Mark {
+                std::uint64_t offset;      // Where the line starts
+                std::uint32_t source_line; // Source lines before it
+                std::uint32_t token;       // Tokens into the line
+
+                bool operator==(const Mark&) const = default;
+        };
+        Mark mark(std::size_t token) const;
+        // Moves the cursor to a marked position
+        void restore(const Mark& mark); // Can throw
+
+        // Source locations, for error messages only
+        std::size_t position() const { return cursor_.offset(); }
+        Location location(std::size_t index) const;
+        std::string_view file() const { return io_.file(); }
+
+        // Work counters, gathered into SUBARUU::stats()
+        std::uint64_t tokens_lexed() const {
+            return tokens_lexed_ + tokens_.size();
+        }
+        std::uint64_t resets() const { return resets_; }
+
     private:
-        // Token parsing methods
-        TokenType get_next_token();
-        TokenType token_relation();
-        TokenType token_operation();
-        TokenType token_string();
-        TokenType token_keyword();
-        TokenType token_number();
-        TokenType token_eol(int c);
+        // Lexes a run of whole lines into arrays of its own, so that the
+        // chunks of a large source can be lexed side by side
+        class Lexer {
+            public:
+                // end points at a '\0' that ends the run
+                Lexer(const char* begin, const char* end);
+                void lex();
+
+            private:
+                // Token parsing methods
+                Token get_next_token();
+                TokenType next_token_type(std::int32_t& value);
+                TokenType token_string(std::int32_t& value);
+                TokenType token_keyword();
+                TokenType token_number(std::int32_t& value);
+                void skip_comment();
+
+                Cursor<char> source_;
+                std::vector<Token> tokens_;
+                std::string literal_pool_;
+                std::vector<std::uint32_t> literal_ends_;
+                std::vector<std::uint32_t> columns_;
+                std::vector<std::uint32_t> line_tokens_;
+                std::vector<NumberedLine> lines_;
+                std::size_t line_begin_; // Where the line being lexed starts
+
+                friend class Tokenizer;
+        };
+
+        static std::size_t window_size(Loading loading, std::size_t window);
+        void lex();
+        void lex_serial();
+        bool lex_parallel();
+        void adopt(Lexer& lexer);
+        void append(Lexer& lexer, std::uint64_t offset);
+
+        // Streaming
+        void index_lines();
+        bool find_in_window(int line);
+        bool find_in(std::size_t first, int line);
+        void seek_window(std::uint64_t offset, std::uint32_t lines_before);
+
+        // A numbered line of a streamed source, as kept in the line index
+        struct IndexEntry {
+                std::int32_t line;
+                std::uint32_t source_line; // Counted from 1
+                std::uint64_t offset;      // Where the line starts
+        };
 
         // Member variables
-        std::unique_ptr<IO> io_;
-        TokenType current_token_;
-        TokenData token_data_;
-        std::vector<KeywordToken> keywords_;
+        IO io_;
+        Loading loading_;
+        std::size_t lex_chunk_;
+        unsigned lex_threads_;
+        std::vector<Token> tokens_;
+        Cursor<Token> cursor_;
+        // String literals, back to back; literal i ends at literal_ends_[i]
+        std::string literal_pool_;
+        std::vector<std::uint32_t> literal_ends_;
+        // The cold location table: each token's column, and the index of
+        // the first token on each source line
+        std::vector<std::uint32_t> columns_;
+        std::vector<std::uint32_t> line_tokens_;
+        std::vector<NumberedLine> lines_;
+        std::uint64_t resets_;
+        std::uint64_t tokens_lexed_; // By the windows before this one
+
+        // Streaming state. The line index is a temporary file of
+        // IndexEntry records, one for each numbered line lexed so far, so
+        // a backward jump can find the window to read again without the
+        // whole file's lines being held in memory.
+        std::uint32_t lines_before_; // Source lines before this window
+        std::FILE* line_index_;
+        std::uint64_t index_entries_;
+        std::uint64_t indexed_to_; // File offset lines are indexed up to
+        std::int32_t index_last_;  // The line indexed last
+        bool index_sorted_;        // Line numbers only ever went up
+        bool index_writing_;       // Else the file was last read
 };
+
+static_assert(sizeof(Tokenizer::Token) == 8, "Tokens must stay packed");
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdio>
+#include <ostream>
+#include <streambuf>
+#include <string_view>
+
+// Categories of the trace log; any mix of them can be enabled at runtime.
+enum class TraceCategory : unsigned {
+    LEXER = 1u << 0,
+    PARSER = 1u << 1,
+    JUMPS = 1u << 2,
+    VARIABLES = 1u << 3,
+    OUTPUT = 1u << 4,
+};
+
+constexpr unsigned TRACE_ALL = 0x1f;
+
+// The enabled categories. make debug builds start with all of them on.
+#ifdef DEBUG_MODE
+inline unsigned trace_categories = TRACE_ALL;
+#else
+inline unsigned trace_categories = 0;
+#endif
+
+inline bool trace_enabled(TraceCategory category) noexcept {
+    return trace_categories & static_cast<unsigned>(category);
+}
+
+// Turns a list like "lexer,jumps" or "all" into a category mask
+bool parse_trace_categories(std::string_view list, unsigned& mask);
+const char* trace_category_name(TraceCategory category) noexcept;
+
+// Buffered text log behind TRACE_LOG. Records are formatted straight into
+// a fixed buffer that is written out when full, on flush() and on exit,
+// never once per record.
+class TraceLog {
+    public:
+        TraceLog();
+        ~TraceLog();
+        TraceLog(const TraceLog&) = delete;
+        TraceLog& operator=(const TraceLog&) = delete;
+
+        // Sends the log to a file instead of stderr
+        void open(std::string_view path); // Can throw
+
+        // Starts a record; the caller streams the message, then calls end()
+        std::ostream& begin(TraceCategory category);
+        void end();
+        void flush() noexcept;
+
+    private:
+        class Buffer : public std::streambuf {
+            public:
+                explicit Buffer(std::FILE* file);
+                void set_file(std::FILE* file) noexcept;
+                std::FILE* file() const noexcept { return file_; }
+                int sync() override;
+
+            protected:
+                int_type overflow(int_type c) override;
+
+            private:
+                void write_out() noexcept;
+
+                std::FILE* file_;
+                char data_[1 << 16];
+        };
+
+        Buffer buffer_;
+        std::ostream stream_;
+        bool owns_file_;
+};
+
+TraceLog& trace_log();
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "config.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// Writes a trace-event JSON file (the "JSON Array Format" read by
+// chrome://tracing and Perfetto). Events are formatted into a buffer that
+// is written out in large chunks. The array is left open until close(),
+// which viewers accept, so a trace cut short by a crash still loads. The
+// buffer is reserved up front and events are capped in size, so recording
+// one never allocates.
+class Tracer {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // Keeps one line block and one flush in every sample_every, and at
+        // most max_events events in all
+        explicit Tracer(std::string_view path,
+                        std::uint64_t sample_every = 1,
+                        std::uint64_t max_events =
+                          SUBARUU_TRACE_MAX_EVENTS); // Can throw
+        ~Tracer();
+        Tracer(const Tracer&) = delete;
+        Tracer& operator=(const Tracer&) = delete;
+
+        // Records the time spent in a scope as one event
+        class Span {
+            public:
+                Span(Tracer* tracer, const char* name, const char* category)
+                  : tracer_(tracer)
+                  , name_(name)
+                  , category_(category)
+                  , start_(tracer ? Clock::now() : Clock::time_point()) {}
+                ~Span() {
+                    if (tracer_) {
+                        tracer_->complete(name_, category_, start_);
+                    }
+                }
+                Span(const Span&) = delete;
+                Span& operator=(const Span&) = delete;
+
+            private:
+                Tracer* tracer_;
+                const char* name_;
+                const char* category_;
+                Clock::time_point start_;
+        };
+
+        // A line block is the run of lines entered between two jumps. Only
+        // the first line of a sampled block reads the clock.
+        void line(int line) {
+            if (block_lines_ == 0) {
+                open_block(line);
+            }
+            last_line_ = line;
+            ++block_lines_;
+        }
+        void jump() {
+            if (block_lines_ != 0) {
+                close_block();
+            }
+        }
+
+        // Whether the next output flush is one to time
+        [[nodiscard]] bool sample_flush() noexcept {
+            return flushes_++ % sample_every_ == 0;
+        }
+
+        // Adds an event that started at start and ends now
+        void complete(const char* name,
+                      const char* category,
+                      Clock::time_point start) noexcept;
+
+        // Closes the open block and writes everything buffered so far
+        void finish() noexcept;
+        // Finishes and terminates the JSON array; called by the destructor
+        void close() noexcept;
+
+        [[nodiscard]] std::uint64_t events() const noexcept {
+            return events_;
+        }
+        [[nodiscard]] std::uint64_t dropped() const noexcept {
+            return dropped_;
+        }
+
+    private:
+        void open_block(int line);
+        void close_block() noexcept;
+        bool reserve_event() noexcept;
+        void append_event(std::string_view name,
+                          const char* category,
+                          Clock::time_point start,
+                          Clock::time_point end);
+        void append_number(std::uint64_t value);
+        void append_micros(Clock::duration duration);
+        void write_buffer() noexcept;
+
+        std::FILE* file_;
+        std::string buffer_;
+        Clock::time_point origin_;
+        std::uint64_t sample_every_;
+        std::uint64_t max_events_;
+        std::uint64_t events_ = 0;
+        std::uint64_t dropped_ = 0;
+        std::uint64_t blocks_ = 0;
+        std::uint64_t flushes_ = 0;
+
+        // The open line block
+        bool block_sampled_ = false;
+        int first_line_ = 0;
+        int last_line_ = 0;
+        std::uint64_t block_lines_ = 0;
+        Clock::time_point block_start_;
+};
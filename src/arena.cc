@@ -0,0 +1,27 @@
+#include "../include/arena.h"
+
+/******************************************************************************/
+
+/**
+ * allocate
+ *
+ * Hands out the next count ints of the block being filled, starting a new
+ * block when they do not fit in what is left of it.
+ *
+ * @param count How many ints
+ * @return The first of them, all zero
+ * @throws std::bad_alloc if memory runs out
+ */
+int* Arena::allocate(std::size_t count) {
+    if (count > SUBARUU_ARENA_BLOCK) {
+        large_.push_back(std::make_unique<int[]>(count));
+        return large_.back().get();
+    }
+    if (blocks_.empty() || count > SUBARUU_ARENA_BLOCK - used_) {
+        blocks_.push_back(std::make_unique<int[]>(SUBARUU_ARENA_BLOCK));
+        used_ = 0;
+    }
+    int* const run = blocks_.back().get() + used_;
+    used_ += count;
+    return run;
+}
@@ -8,11 +8,24 @@
  * IO Constructor
  *
  * @param filename The path to the file to be opened and loaded into memory
+ * @param window 0 to load the whole file now; otherwise the file is
+ *        streamed this many bytes at a time and nothing is read until
+ *        next_window()
  * @throws std::runtime_error If the file cannot be opened
  */
-IO::IO(std::string_view filename)
-  : filename_(filename) {
-    load_file();
+IO::IO(std::string_view filename, std::size_t window)
+  : filename_(filename)
+  , window_(window) {
+    if (!streaming()) {
+        load_file();
+        return;
+    }
+    stream_.open(filename_, std::ios::binary);
+    if (!stream_.is_open()) {
+        throw std::runtime_error("Failed to open file: " +
+                                 std::string(filename_));
+    }
+    current_pos_ = content_.begin();
 }
 
 /**
@@ -157,3 +170,57 @@ int IO::peek() { // Changed return type to int
         return EOF;
     }
 }
+
+/**
+ * next_window
+ *
+ * Replaces the content with the next whole lines of a streamed file. A
+ * window's worth is read at a time and cut after its last newline; the
+ * rest is carried over to the next window, so no line is ever split. A
+ * line longer than the window makes the window grow to hold it.
+ *
+ * @param void
+ * @return false once the file is exhausted
+ * @throws std::runtime_error If the file cannot be read
+ */
+bool IO::next_window() {
+    window_offset_ += content_.size();
+    content_.swap(carry_);
+    carry_.clear();
+    std::string chunk(window_, '\0');
+    while (stream_) {
+        stream_.read(chunk.data(), static_cast<std::streamsize>(window_));
+        const auto got = static_cast<std::size_t>(stream_.gcount());
+        const std::size_t newline = chunk.rfind('\n', got ? got - 1 : 0);
+        if (got != 0 && newline != std::string::npos) {
+            content_.append(chunk, 0, newline + 1);
+            carry_.assign(chunk, newline + 1, got - newline - 1);
+            break;
+        }
+        content_.append(chunk, 0, got);
+    }
+    if (stream_.bad()) {
+        throw std::runtime_error("Failed to read file: " +
+                                 std::string(filename_));
+    }
+    current_pos_ = content_.begin();
+    return !content_.empty();
+}
+
+/**
+ * seek_window
+ *
+ * Starts streaming again from a line that has been read before
+ *
+ * @param offset File offset of the start of a line
+ * @return false if nothing can be read from there
+ * @throws std::runtime_error If the file cannot be read
+ */
+bool IO::seek_window(std::uint64_t offset) {
+    stream_.clear();
+    stream_.seekg(static_cast<std::streamoff>(offset));
+    content_.clear();
+    carry_.clear();
+    window_offset_ = offset;
+    return next_window();
+}
@@ -0,0 +1,198 @@
+#include "../include/line_table.h"
+
+#include <algorithm>
+
+/******************************************************************************/
+
+/**
+ * index
+ *
+ * Makes the lines added since the last call findable. Lines that carry on
+ * in ascending order, as almost every program's do, are appended and
+ * slotted one by one; any other order sorts the table again.
+ *
+ * @param void
+ * @return void
+ */
+void LineTable::index() {
+    if (pending_.empty()) {
+        return;
+    }
+    if (!append_sorted()) {
+        rebuild();
+    }
+    pending_.clear();
+    cache_ = uncached();
+}
+
+/**
+ * clear
+ *
+ * @param void
+ * @return void
+ */
+void LineTable::clear() {
+    entries_.clear();
+    pending_.clear();
+    slots_.clear();
+    base_ = 0;
+    dense_ = false;
+    cache_ = uncached();
+}
+
+/**
+ * numbers
+ *
+ * Token indices grow through the program, so sorting the entries by token
+ * puts them back in its order.
+ *
+ * @param void
+ * @return Every line number, in program order
+ */
+std::vector<int> LineTable::numbers() const {
+    std::vector<Entry> order(entries_);
+    std::sort(order.begin(), order.end(), [](const Entry& a, const Entry& b) {
+        return a.token < b.token;
+    });
+    std::vector<int> lines;
+    lines.reserve(order.size());
+    for (const Entry& entry : order) {
+        lines.push_back(entry.line);
+    }
+    return lines;
+}
+
+/**
+ * search
+ *
+ * @param line The line number to look for
+ * @return Its first entry, or NONE
+ */
+std::uint32_t LineTable::search(int line) const noexcept {
+    const auto found = std::lower_bound(
+      entries_.begin(),
+      entries_.end(),
+      line,
+      [](const Entry& entry, int number) { return entry.line < number; });
+    if (found == entries_.end() || found->line != line) {
+        return NONE;
+    }
+    return static_cast<std::uint32_t>(found - entries_.begin());
+}
+
+/**
+ * append_sorted
+ *
+ * Appends the pending lines if they keep the table sorted.
+ *
+ * @param void
+ * @return false, leaving the table as it was, if they would not
+ */
+bool LineTable::append_sorted() {
+    int previous = entries_.empty() ? pending_.front().line
+                                    : entries_.back().line;
+    for (const Entry& entry : pending_) {
+        if (entry.line < previous) {
+            return false;
+        }
+        previous = entry.line;
+    }
+
+    const bool was_empty = entries_.empty();
+    const auto start = static_cast<std::uint32_t>(entries_.size());
+    entries_.insert(entries_.end(), pending_.begin(), pending_.end());
+    const auto end = static_cast<std::uint32_t>(entries_.size());
+
+    if (was_empty) {
+        index_slots();
+        return true;
+    }
+    for (std::uint32_t entry = start; dense_ && entry < end; ++entry) {
+        if (!add_slot(entry)) {
+            dense_ = false;
+            slots_.clear();
+        }
+    }
+    return true;
+}
+
+/**
+ * rebuild
+ *
+ * Sorts the pending lines in with the others and redoes the slots.
+ *
+ * @param void
+ * @return void
+ */
+void LineTable::rebuild() {
+    entries_.insert(entries_.end(), pending_.begin(), pending_.end());
+    std::sort(entries_.begin(),
+              entries_.end(),
+              [](const Entry& a, const Entry& b) {
+                  return a.line != b.line ? a.line < b.line
+                                          : a.token < b.token;
+              });
+    index_slots();
+}
+
+/**
+ * index_slots
+ *
+ * Gives every multiple of the stride from the first line to the last a
+ * slot, if all the lines are multiples and there are few enough slots.
+ *
+ * @param void
+ * @return void
+ */
+void LineTable::index_slots() {
+    slots_.clear();
+    dense_ = false;
+    if (entries_.empty()) {
+        return;
+    }
+    base_ = entries_.front().line;
+    const std::int64_t span =
+      (static_cast<std::int64_t>(entries_.back().line) - base_) /
+        SUBARUU_LINE_STRIDE +
+      1;
+    if (base_ < 0 || base_ % SUBARUU_LINE_STRIDE != 0 ||
+        static_cast<std::uint64_t>(span) >
+          SUBARUU_LINE_SLOTS_PER_LINE * entries_.size()) {
+        return;
+    }
+    slots_.assign(static_cast<std::size_t>(span), NONE);
+    dense_ = true;
+    for (std::uint32_t entry = 0; dense_ && entry < entries_.size();
+         ++entry) {
+        dense_ = add_slot(entry);
+    }
+    if (!dense_) {
+        slots_.clear();
+    }
+}
+
+/**
+ * add_slot
+ *
+ * @param entry An entry at or past the last one slotted
+ * @return false if its line is not a multiple of the stride, or would
+ *         leave too many slots for the lines there are
+ */
+bool LineTable::add_slot(std::uint32_t entry) {
+    const std::int32_t line = entries_[entry].line;
+    if (line % SUBARUU_LINE_STRIDE != 0) {
+        return false;
+    }
+    const auto slot = static_cast<std::size_t>(
+      (static_cast<std::int64_t>(line) - base_) / SUBARUU_LINE_STRIDE);
+    if (slot >= slots_.size()) {
+        if (slot + 1 > SUBARUU_LINE_SLOTS_PER_LINE * entries_.size()) {
+            return false;
+        }
+        slots_.resize(slot + 1, NONE);
+    }
+    if (slots_[slot] == NONE) {
+        slots_[slot] = entry;
+    }
+    return true;
+}
@@ -1,11 +1,14 @@
 
+#include <cstdint>
 #include <cstdlib> // For EXIT_SUCCESS, EXIT_FAILURE
 #include <cstring> // For strcmp
 #include <iostream>
 #include <string>
 
+#include "../include/config.h"
 #include "../include/subaruu.h"
 #include "../include/tokenizer.h"
+#include "../include/trace_log.h"
 
 // SUBARU's version number.
 constexpr const char* VERSION = "2.0";
@@ -14,9 +17,30 @@ constexpr const char* VERSION = "2.0";
 const std::string NOARGS = "VERSION: " + std::string(VERSION) +
                            "\n"
                            "***************************************\n"
-                           "  Howto: ./subaru [-debug] file." +
+                           "  Howto: ./subaru [-debug] [-profile] [-sample]"
+                           " [-perfcounters] [-stats]\n"
+                           "               [-lazy | -stream]\n"
+                           "               [-trace out.json [-trace-sample n]"
+                           " [-trace-limit n]]\n"
+                           "               [-log categories [-log-file path]]"
+                           " file." +
                            std::string("subaru") + "\n";
 
+// Command line switches given before the file name.
+struct Options {
+        bool debug = false;
+        bool profile = false;
+        bool sample = false;
+        bool perfcounters = false;
+        bool stats = false;
+        Tokenizer::Loading loading = Tokenizer::Loading::WHOLE;
+        const char* trace = nullptr;
+        std::uint64_t trace_sample = 1;
+        std::uint64_t trace_limit = SUBARUU_TRACE_MAX_EVENTS;
+        const char* log_file = nullptr;
+        const char* filename = nullptr;
+};
+
 /**
  * @brief Check if the filename has the valid extension.
  *
@@ -31,55 +55,161 @@ bool valid(const std::string& filename) {
     return ext == "subaru";
 }
 
-int main(int argc, char** argv) {
-    if (argc < 2) {
-        // No arguments provided; print usage message.
-        std::cout << NOARGS;
-    }
-    // Debug mode: run the tokenizer and print tokens.
-    else if (std::strcmp(argv[1], "-debug") == 0) {
-        if (argc < 3) {
-            std::cout << NOARGS;
-        } else {
-            // Check if the file has a valid extension.
-            if (!valid(argv[2])) {
-                std::cerr
-                  << "Invalid file extension. Expected a .subaru file.\n";
-                return EXIT_FAILURE;
-            }
-
-            try {
-                Tokenizer tokenizer(argv[2]);
-                // Run the tokenizer until EOF, printing each token.
-                do {
-                    Tokenizer::TokenType token = tokenizer.current_token();
-                    std::cout << tokenizer.token_to_string(token) << " ";
-                    if (token == Tokenizer::TokenType::EOL)
-                        std::cout << "\n";
-                    tokenizer.next_token();
-                } while (!tokenizer.finished());
-            } catch (const std::exception& e) {
-                std::cerr << "Tokenizer Error: " << e.what() << "\n";
-                return EXIT_FAILURE;
+/**
+ * @brief Parse the switches and the file name.
+ *
+ * @param argc Argument count from main.
+ * @param argv Argument vector from main.
+ * @param options Filled in from the arguments.
+ * @return false if an unknown switch was given.
+ */
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-debug") == 0) {
+            options.debug = true;
+        } else if (std::strcmp(argv[i], "-profile") == 0) {
+            options.profile = true;
+        } else if (std::strcmp(argv[i], "-sample") == 0) {
+            options.sample = true;
+        } else if (std::strcmp(argv[i], "-perfcounters") == 0) {
+            options.perfcounters = true;
+        } else if (std::strcmp(argv[i], "-stats") == 0) {
+            options.stats = true;
+        } else if (std::strcmp(argv[i], "-lazy") == 0) {
+            options.loading = Tokenizer::Loading::LAZY;
+        } else if (std::strcmp(argv[i], "-stream") == 0) {
+            options.loading = Tokenizer::Loading::STREAM;
+        } else if (std::strcmp(argv[i], "-trace") == 0 && i + 1 < argc) {
+            options.trace = argv[++i];
+        } else if (std::strcmp(argv[i], "-trace-sample") == 0 &&
+                   i + 1 < argc) {
+            options.trace_sample = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "-trace-limit") == 0 &&
+                   i + 1 < argc) {
+            options.trace_limit = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "-log") == 0 && i + 1 < argc) {
+            if (!parse_trace_categories(argv[++i], trace_categories)) {
+                std::cerr << "Unknown log category in: " << argv[i]
+                          << " (use lexer, parser, jumps, variables, output"
+                             " or all)\n";
+                return false;
             }
+        } else if (std::strcmp(argv[i], "-log-file") == 0 && i + 1 < argc) {
+            options.log_file = argv[++i];
+        } else if (argv[i][0] == '-') {
+            std::cerr << "Unknown option: " << argv[i] << "\n";
+            return false;
+        } else {
+            options.filename = argv[i];
+            break;
         }
     }
-    // Run the SUBARU interpreter.
-    else {
-        // Check if the file has a valid extension.
-        if (!valid(argv[1])) {
-            std::cerr << "Invalid file extension. Expected a .subaru file.\n";
-            return EXIT_FAILURE;
-        }
+    return true;
+}
 
+/**
+ * @brief Run a program and dump whatever was gathered on the way out.
+ *
+ * @param options The parsed command line.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+int run(const Options& options) {
+    int status = EXIT_SUCCESS;
+    try {
+        SUBARUU subaruu(options.filename, options.loading);
+        if (options.profile) {
+            subaruu.enable_profiler();
+        }
+        if (options.sample) {
+            subaruu.enable_sampler();
+        }
+        if (options.trace) {
+            subaruu.enable_tracer(
+              options.trace, options.trace_sample, options.trace_limit);
+        }
+        // Missing counters are not worth failing the run over.
+        const bool perfcounters =
+          options.perfcounters && subaruu.enable_perf_counters();
+        if (options.perfcounters && !perfcounters) {
+            std::cerr << "Hardware counters unavailable, running without "
+                         "them: "
+                      << subaruu.perf_counters()->error() << "\n";
+        }
         try {
-            SUBARUU subaruu(argv[1]);
             subaruu.run();
+        } catch (const std::exception& e) {
+            std::cerr << "SUBARUU Error: " << e.what() << "\n";
+            status = EXIT_FAILURE;
+        }
+        // Reports are written even when the program failed part way.
+        std::cout.flush();
+        trace_log().flush();
+        if (options.profile) {
+            subaruu.profiler()->report(std::cerr);
+            subaruu.profiler()->write(SUBARUU_PROFILE_OUTPUT);
+        }
+        if (options.sample) {
+            subaruu.sampler()->report(std::cerr);
+            subaruu.sampler()->write_folded(SUBARUU_SAMPLE_OUTPUT,
+                                            options.filename);
+        }
+        if (perfcounters) {
+            subaruu.perf_counters()->report(std::cerr);
+            subaruu.perf_counters()->write(SUBARUU_PERF_OUTPUT);
+        }
+        if (options.stats) {
+            const Stats stats = subaruu.stats();
+            stats.report(std::cerr);
+            stats.write(SUBARUU_STATS_OUTPUT);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "SUBARUU Error: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    return status;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        return EXIT_FAILURE;
+    }
+    if (options.log_file) {
+        try {
+            trace_log().open(options.log_file);
         } catch (const std::exception& e) {
             std::cerr << "SUBARUU Error: " << e.what() << "\n";
             return EXIT_FAILURE;
         }
     }
-    // Program completed successfully.
-    return EXIT_SUCCESS;
+    if (!options.filename) {
+        // No file provided; print usage message.
+        std::cout << NOARGS;
+        return EXIT_SUCCESS;
+    }
+    // Check if the file has a valid extension.
+    if (!valid(options.filename)) {
+        std::cerr << "Invalid file extension. Expected a .subaru file.\n";
+        return EXIT_FAILURE;
+    }
+    // Debug mode: run the tokenizer and print tokens.
+    if (options.debug) {
+        try {
+            Tokenizer tokenizer(options.filename, options.loading);
+            // Run the tokenizer until EOF, printing each token.
+            do {
+                Tokenizer::TokenType token = tokenizer.current_token();
+                std::cout << tokenizer.token_to_string(token) << " ";
+                if (token == Tokenizer::TokenType::EOL)
+                    std::cout << "\n";
+                tokenizer.next_token();
+            } while (!tokenizer.finished());
+        } catch (const std::exception& e) {
+            std::cerr << "Tokenizer Error: " << e.what() << "\n";
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    // Run the SUBARU interpreter.
+    return run(options);
 }
@@ -0,0 +1,388 @@
+#include "../include/perf_counters.h"
+#include "../include/stream_format.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <linux/perf_event.h>
+#include <ostream>
+#include <stdexcept>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/******************************************************************************/
+
+namespace {
+// The hardware event behind each PerfCounters::Event.
+constexpr std::uint64_t EVENT_CONFIG[PerfCounters::EVENT_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_MISSES,
+};
+
+/**
+ * open_event
+ *
+ * @param config One of the PERF_COUNT_HW_* events
+ * @param group_fd The group leader, or -1 to open a new group
+ * @return The counter's file descriptor, or -1 with errno set
+ */
+int open_event(std::uint64_t config, int group_fd) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.disabled = group_fd < 0 ? 1 : 0;
+    // User space only, which is all the interpreter controls and what an
+    // unprivileged process is allowed to count.
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(
+      syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+/**
+ * per_kilo
+ *
+ * @param count Events counted
+ * @param instructions Instructions retired over the same span
+ * @return Events per thousand instructions
+ */
+double per_kilo(std::uint64_t count, std::uint64_t instructions) {
+    return instructions ? 1000.0 * static_cast<double>(count) / instructions
+                        : 0.0;
+}
+} // namespace
+
+/**
+ * PerfCounters Destructor
+ *
+ * Closes whatever counters are still open
+ */
+PerfCounters::~PerfCounters() { close(); }
+
+/**
+ * event_name
+ *
+ * @param event The event to name
+ * @return The name perf(1) uses for it
+ */
+const char* PerfCounters::event_name(Event event) noexcept {
+    switch (event) {
+        case CYCLES:
+            return "cycles";
+        case INSTRUCTIONS:
+            return "instructions";
+        case BRANCH_MISSES:
+            return "branch-misses";
+        case CACHE_MISSES:
+            return "cache-misses";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * open
+ *
+ * Opens every event the kernel allows into one group and starts it. An
+ * event that fails on its own is skipped; only when none open at all is
+ * the whole mode unavailable.
+ *
+ * @param void
+ * @return true if at least one counter is running
+ */
+bool PerfCounters::open() {
+    close();
+    int first_errno = 0;
+    for (int event = 0; event < EVENT_COUNT; ++event) {
+        const int fd = open_event(EVENT_CONFIG[event], leader_);
+        if (fd < 0) {
+            if (!first_errno) {
+                first_errno = errno;
+            }
+            continue;
+        }
+        if (leader_ < 0) {
+            leader_ = fd;
+        }
+        fds_[event] = fd;
+        slots_[event] = opened_++;
+    }
+    if (!available()) {
+        error_ = std::string("perf_event_open failed: ") +
+                 std::strerror(first_errno);
+        if (first_errno == EACCES || first_errno == EPERM) {
+            error_ += " (see /proc/sys/kernel/perf_event_paranoid)";
+        }
+        return false;
+    }
+    ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    error_.clear();
+    return true;
+}
+
+/**
+ * close
+ *
+ * Closes every open counter. Counts gathered so far are kept.
+ *
+ * @param void
+ * @return void
+ */
+void PerfCounters::close() noexcept {
+    for (int& fd : fds_) {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    slots_.fill(-1);
+    leader_ = -1;
+    opened_ = 0;
+    current_ = nullptr;
+}
+
+/**
+ * seed
+ *
+ * Creates an empty entry for every line number found while building the
+ * line map, so no insertions happen while the program executes.
+ *
+ * @param lines The line numbers in SUBARUU::build_line_map()'s table
+ * @return void
+ */
+void PerfCounters::seed(const std::vector<int>& lines) {
+    lines_.reserve(lines.size());
+    for (int line : lines) {
+        lines_.try_emplace(line);
+    }
+}
+
+/**
+ * read
+ *
+ * @param values Filled with the running totals, 0 for events not counted
+ * @return false if the group could not be read
+ */
+bool PerfCounters::read(Values& values) const noexcept {
+    // PERF_FORMAT_GROUP layout: the number of events, then their values.
+    std::uint64_t buffer[1 + EVENT_COUNT];
+    const ssize_t size = ::read(leader_, buffer, sizeof(buffer));
+    if (size < static_cast<ssize_t>(sizeof(std::uint64_t)) ||
+        buffer[0] != static_cast<std::uint64_t>(opened_)) {
+        return false;
+    }
+    for (int event = 0; event < EVENT_COUNT; ++event) {
+        values[event] = slots_[event] >= 0 ? buffer[1 + slots_[event]] : 0;
+    }
+    return true;
+}
+
+/**
+ * charge
+ *
+ * Adds the deltas since the last read to the running line.
+ *
+ * @param now The totals just read
+ * @return void
+ */
+void PerfCounters::charge(const Values& now) noexcept {
+    if (current_) {
+        for (int event = 0; event < EVENT_COUNT; ++event) {
+            current_->events[event] += now[event] - last_[event];
+        }
+    }
+    last_ = now;
+}
+
+/**
+ * enter
+ *
+ * Does nothing when the counters are not open.
+ *
+ * @param line The line that starts running
+ * @return void
+ */
+void PerfCounters::enter(int line) {
+    if (!available()) {
+        return;
+    }
+    Values now;
+    if (read(now)) {
+        charge(now);
+    }
+    current_ = &lines_[line];
+    ++current_->hits;
+}
+
+/**
+ * finish
+ *
+ * Charges the line that is still running and closes it. Calling it again
+ * without a new enter() is harmless.
+ *
+ * @param void
+ * @return void
+ */
+void PerfCounters::finish() noexcept {
+    if (!available() || !current_) {
+        return;
+    }
+    Values now;
+    if (read(now)) {
+        charge(now);
+    }
+    current_ = nullptr;
+}
+
+/**
+ * sorted
+ *
+ * @param void
+ * @return All line entries, most cycles first; ties are broken by line
+ *         number so the order is stable between runs
+ */
+std::vector<PerfCounters::LineEntry> PerfCounters::sorted() const {
+    std::vector<LineEntry> entries(lines_.begin(), lines_.end());
+    std::sort(entries.begin(),
+              entries.end(),
+              [](const LineEntry& a, const LineEntry& b) {
+                  const auto a_cycles = a.second.events[CYCLES];
+                  const auto b_cycles = b.second.events[CYCLES];
+                  if (a_cycles != b_cycles) {
+                      return a_cycles > b_cycles;
+                  }
+                  return a.first < b.first;
+              });
+    return entries;
+}
+
+/**
+ * totals
+ *
+ * @param void
+ * @return Hits and events summed over every line
+ */
+PerfCounters::LineCounts PerfCounters::totals() const noexcept {
+    LineCounts total;
+    for (const auto& [_, counts] : lines_) {
+        total.hits += counts.hits;
+        for (int event = 0; event < EVENT_COUNT; ++event) {
+            total.events[event] += counts.events[event];
+        }
+    }
+    return total;
+}
+
+/**
+ * report
+ *
+ * Prints the lines with the most cycles. Instructions per cycle tell
+ * dispatch-bound lines (high IPC, many instructions) from memory-bound
+ * ones (low IPC, many cache misses); misses are given per thousand
+ * instructions. Events the machine does not count are shown as "-".
+ *
+ * @param out The stream to print to
+ * @param limit The maximum number of lines to print, 0 for all of them
+ * @return void
+ */
+void PerfCounters::report(std::ostream& out, std::size_t limit) const {
+    const auto entries = sorted();
+    const LineCounts total = totals();
+    const std::size_t shown =
+      limit == 0 ? entries.size() : std::min(limit, entries.size());
+    const StreamFormat format(out);
+
+    out << "PERFCOUNTERS: " << entries.size() << " lines";
+    for (int event = 0; event < EVENT_COUNT; ++event) {
+        const auto e = static_cast<Event>(event);
+        out << ", ";
+        if (supported(e)) {
+            out << total.events[event] << " ";
+        }
+        out << event_name(e) << (supported(e) ? "" : " unsupported");
+    }
+    out << "\n";
+    out << std::setw(8) << "line" << std::setw(12) << "hits" << std::setw(16)
+        << "cycles" << std::setw(16) << "instructions" << std::setw(7)
+        << "IPC" << std::setw(12) << "br-miss/K" << std::setw(12)
+        << "$-miss/K" << "\n";
+
+    // Prints one cell, or "-" when the events behind it are not counted.
+    auto cell = [&out](bool counted, int width, auto value) {
+        out << std::setw(width);
+        if (counted) {
+            out << value;
+        } else {
+            out << "-";
+        }
+    };
+    out << std::fixed << std::setprecision(2);
+    for (std::size_t i = 0; i < shown; ++i) {
+        const auto& [line, counts] = entries[i];
+        const auto& e = counts.events;
+        out << std::setw(8) << line << std::setw(12) << counts.hits;
+        cell(supported(CYCLES), 16, e[CYCLES]);
+        cell(supported(INSTRUCTIONS), 16, e[INSTRUCTIONS]);
+        cell(supported(CYCLES) && supported(INSTRUCTIONS),
+             7,
+             e[CYCLES] ? static_cast<double>(e[INSTRUCTIONS]) / e[CYCLES]
+                       : 0.0);
+        cell(supported(BRANCH_MISSES) && supported(INSTRUCTIONS),
+             12,
+             per_kilo(e[BRANCH_MISSES], e[INSTRUCTIONS]));
+        cell(supported(CACHE_MISSES) && supported(INSTRUCTIONS),
+             12,
+             per_kilo(e[CACHE_MISSES], e[INSTRUCTIONS]));
+        out << "\n";
+    }
+}
+
+/**
+ * write
+ *
+ * Writes every line entry as JSON, most cycles first. Events the machine
+ * does not count are left out of the records.
+ *
+ * @param path The file to write
+ * @return void
+ * @throws std::runtime_error If the file cannot be opened
+ */
+void PerfCounters::write(std::string_view path) const {
+    std::ofstream file(std::string(path), std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + std::string(path));
+    }
+
+    file << "{\n  \"events\": [";
+    bool first = true;
+    for (int event = 0; event < EVENT_COUNT; ++event) {
+        if (supported(static_cast<Event>(event))) {
+            file << (first ? "" : ", ") << '"'
+                 << event_name(static_cast<Event>(event)) << '"';
+            first = false;
+        }
+    }
+    file << "],\n  \"lines\": [";
+    first = true;
+    for (const auto& [line, counts] : sorted()) {
+        file << (first ? "\n" : ",\n") << "    { \"line\": " << line
+             << ", \"hits\": " << counts.hits;
+        for (int event = 0; event < EVENT_COUNT; ++event) {
+            if (supported(static_cast<Event>(event))) {
+                file << ", \"" << event_name(static_cast<Event>(event))
+                     << "\": " << counts.events[event];
+            }
+        }
+        file << " }";
+        first = false;
+    }
+    file << "\n  ]\n}\n";
+}
@@ -0,0 +1,138 @@
+#include "../include/profiler.h"
+#include "../include/stream_format.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+/******************************************************************************/
+
+/**
+ * seed
+ *
+ * Creates an empty entry for every line number found while building the
+ * line map, so lines that never run still show up in the report and no
+ * insertions happen while the program executes.
+ *
+ * @param lines The line numbers in SUBARUU::build_line_map()'s table
+ * @return void
+ */
+void Profiler::seed(const std::vector<int>& lines) {
+    lines_.reserve(lines.size());
+    for (int line : lines) {
+        lines_.try_emplace(line);
+    }
+}
+
+/**
+ * finish
+ *
+ * Charges the cycles of the line that is still running and closes it.
+ * Calling it again without a new enter() is harmless.
+ *
+ * @param void
+ * @return void
+ */
+void Profiler::finish() noexcept {
+    if (current_) {
+        current_->cycles += read_cycles() - last_;
+        current_ = nullptr;
+    }
+}
+
+/**
+ * sorted
+ *
+ * @param void
+ * @return All line entries, most expensive first; ties are broken by
+ *         line number so the order is stable between runs
+ */
+std::vector<Profiler::LineEntry> Profiler::sorted() const {
+    std::vector<LineEntry> entries(lines_.begin(), lines_.end());
+    std::sort(entries.begin(),
+              entries.end(),
+              [](const LineEntry& a, const LineEntry& b) {
+                  if (a.second.cycles != b.second.cycles) {
+                      return a.second.cycles > b.second.cycles;
+                  }
+                  return a.first < b.first;
+              });
+    return entries;
+}
+
+/**
+ * total_cycles
+ *
+ * @param void
+ * @return Sum of the cycles charged to every line
+ */
+std::uint64_t Profiler::total_cycles() const noexcept {
+    std::uint64_t total = 0;
+    for (const auto& [_, stats] : lines_) {
+        total += stats.cycles;
+    }
+    return total;
+}
+
+/**
+ * report
+ *
+ * Prints a table of the most expensive lines, leaving the stream's
+ * number formatting as it was.
+ *
+ * @param out The stream to print to
+ * @param limit The maximum number of lines to print, 0 for all of them
+ * @return void
+ */
+void Profiler::report(std::ostream& out, std::size_t limit) const {
+    const auto entries = sorted();
+    const std::uint64_t total = total_cycles();
+    const std::size_t shown =
+      limit == 0 ? entries.size() : std::min(limit, entries.size());
+    const StreamFormat format(out);
+
+    out << "PROFILE: " << entries.size() << " lines, " << total
+        << " cycles\n";
+    out << std::setw(8) << "line" << std::setw(14) << "hits"
+        << std::setw(18) << "cycles" << std::setw(9) << "%"
+        << std::setw(14) << "cycles/hit" << "\n";
+    for (std::size_t i = 0; i < shown; ++i) {
+        const auto& [line, stats] = entries[i];
+        const double share =
+          total ? 100.0 * static_cast<double>(stats.cycles) / total : 0.0;
+        out << std::setw(8) << line << std::setw(14) << stats.hits
+            << std::setw(18) << stats.cycles << std::setw(8) << std::fixed
+            << std::setprecision(2) << share << "%" << std::setw(14)
+            << (stats.hits ? stats.cycles / stats.hits : 0) << "\n";
+    }
+}
+
+/**
+ * write
+ *
+ * Writes every line entry as JSON, most expensive first.
+ *
+ * @param path The file to write
+ * @return void
+ * @throws std::runtime_error If the file cannot be opened
+ */
+void Profiler::write(std::string_view path) const {
+    std::ofstream file(std::string(path), std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + std::string(path));
+    }
+
+    file << "{\n  \"unit\": \"cycles\",\n  \"total_cycles\": "
+         << total_cycles() << ",\n  \"lines\": [";
+    bool first = true;
+    for (const auto& [line, stats] : sorted()) {
+        file << (first ? "\n" : ",\n") << "    { \"line\": " << line
+             << ", \"hits\": " << stats.hits
+             << ", \"cycles\": " << stats.cycles << " }";
+        first = false;
+    }
+    file << "\n  ]\n}\n";
+}
@@ -0,0 +1,311 @@
+#include "../include/sampler.h"
+#include "../include/stream_format.h"
+
+#include <algorithm>
+#include <csignal>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <sys/time.h>
+#include <system_error>
+#include <vector>
+
+/******************************************************************************/
+
+namespace {
+// The sampler SIGPROF is delivered to; there can only be one per process.
+std::atomic<Sampler*> active_sampler{ nullptr };
+struct sigaction previous_action;
+// How often the drain thread empties the ring.
+constexpr std::chrono::milliseconds DRAIN_PERIOD(20);
+} // namespace
+
+/**
+ * Sampler Constructor
+ *
+ * @param line The interpreter's current line, read from the signal handler
+ * @param interval CPU time between two samples
+ */
+Sampler::Sampler(const std::atomic<int>& line,
+                 std::chrono::microseconds interval)
+  : line_(line)
+  , interval_(interval) {}
+
+/**
+ * Sampler Destructor
+ *
+ * Stops the timer and the drain thread if they are still running
+ */
+Sampler::~Sampler() { stop(); }
+
+/**
+ * on_signal
+ *
+ * SIGPROF handler. Only touches lock-free atomics and the ring.
+ *
+ * @param signo Unused
+ * @return void
+ */
+void Sampler::on_signal(int) {
+    Sampler* sampler = active_sampler.load(std::memory_order_acquire);
+    if (sampler) {
+        sampler->record();
+    }
+}
+
+/**
+ * record
+ *
+ * Pushes the current line onto the ring, or counts a drop when the drain
+ * thread has fallen a whole ring behind.
+ *
+ * @param void
+ * @return void
+ */
+void Sampler::record() noexcept {
+    const std::uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= RING_SIZE) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring_[head & (RING_SIZE - 1)] = line_.load(std::memory_order_relaxed);
+    head_.store(head + 1, std::memory_order_release);
+}
+
+/**
+ * drain
+ *
+ * Moves every sample on the ring into the histogram. If the histogram
+ * cannot grow, the samples moved so far stay moved.
+ *
+ * @param void
+ * @return void
+ */
+void Sampler::drain() {
+    const std::uint64_t head = head_.load(std::memory_order_acquire);
+    std::uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(histogram_mutex_);
+    try {
+        for (; tail != head; ++tail) {
+            ++histogram_[ring_[tail & (RING_SIZE - 1)]];
+        }
+    } catch (...) {
+        tail_.store(tail, std::memory_order_release);
+        throw;
+    }
+    tail_.store(tail, std::memory_order_release);
+}
+
+/**
+ * drop_rest
+ *
+ * Counts every sample left on the ring as dropped.
+ *
+ * @param void
+ * @return void
+ */
+void Sampler::drop_rest() noexcept {
+    const std::uint64_t head = head_.load(std::memory_order_acquire);
+    dropped_.fetch_add(head - tail_.load(std::memory_order_relaxed),
+                       std::memory_order_relaxed);
+    tail_.store(head, std::memory_order_release);
+}
+
+/**
+ * drain_loop
+ *
+ * Body of the drain thread: empties the ring until the sampler stops.
+ * Should the histogram fail to grow, the thread gives up and the ring
+ * fills, dropping samples, until stop() deals with what is on it.
+ *
+ * @param void
+ * @return void
+ */
+void Sampler::drain_loop() noexcept {
+    try {
+        while (running_.load(std::memory_order_acquire)) {
+            drain();
+            std::this_thread::sleep_for(DRAIN_PERIOD);
+        }
+    } catch (...) {
+    }
+}
+
+/**
+ * start
+ *
+ * Installs the SIGPROF handler, starts the drain thread with SIGPROF
+ * blocked so samples always land on the interpreter, and arms the timer.
+ *
+ * @param void
+ * @return void
+ * @throws std::runtime_error If another sampler is running, or the drain
+ *         thread cannot be started or the timer armed; the sampler is then
+ *         left as it was, and can be started again
+ */
+void Sampler::start() {
+    Sampler* expected = nullptr;
+    if (!active_sampler.compare_exchange_strong(expected, this)) {
+        throw std::runtime_error("Another sampler is already running");
+    }
+
+    struct sigaction action {};
+    action.sa_handler = &Sampler::on_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, &previous_action);
+
+    sigset_t profile_signal;
+    sigset_t old_mask;
+    sigemptyset(&profile_signal);
+    sigaddset(&profile_signal, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &profile_signal, &old_mask);
+    running_.store(true, std::memory_order_release);
+    try {
+        drainer_ = std::thread(&Sampler::drain_loop, this);
+    } catch (...) {
+        pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+        running_.store(false, std::memory_order_release);
+        sigaction(SIGPROF, &previous_action, nullptr);
+        active_sampler.store(nullptr, std::memory_order_release);
+        throw;
+    }
+    pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+
+    itimerval timer{};
+    timer.it_interval.tv_sec = interval_.count() / 1000000;
+    timer.it_interval.tv_usec = interval_.count() % 1000000;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        stop();
+        throw std::runtime_error("Failed to arm the profiling timer");
+    }
+}
+
+/**
+ * stop
+ *
+ * Disarms the timer, restores the previous handler, joins the drain thread
+ * and drains what is left. Does nothing if the sampler is not running.
+ * Cannot throw: samples the histogram has no room for count as dropped.
+ *
+ * @param void
+ * @return void
+ */
+void Sampler::stop() noexcept {
+    if (!running_.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    itimerval timer{};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    sigaction(SIGPROF, &previous_action, nullptr);
+    active_sampler.store(nullptr, std::memory_order_release);
+
+    if (drainer_.joinable()) {
+        try {
+            drainer_.join();
+        } catch (const std::system_error&) {
+            // The thread sees running_ false and ends on its own
+            drainer_.detach();
+        }
+    }
+    try {
+        drain();
+    } catch (...) {
+        drop_rest();
+    }
+}
+
+/**
+ * histogram
+ *
+ * @param void
+ * @return Sample count per line; line 0 is time spent outside any line
+ */
+std::map<int, std::uint64_t> Sampler::histogram() const {
+    std::lock_guard<std::mutex> lock(histogram_mutex_);
+    return histogram_;
+}
+
+/**
+ * samples
+ *
+ * @param void
+ * @return Number of samples taken, not counting dropped ones
+ */
+std::uint64_t Sampler::samples() const {
+    std::uint64_t total = 0;
+    for (const auto& [_, count] : histogram()) {
+        total += count;
+    }
+    return total;
+}
+
+/**
+ * report
+ *
+ * Prints the lines with the most samples, leaving the stream's number
+ * formatting as it was.
+ *
+ * @param out The stream to print to
+ * @param limit The maximum number of lines to print, 0 for all of them
+ * @return void
+ */
+void Sampler::report(std::ostream& out, std::size_t limit) const {
+    const auto counts = histogram();
+    std::vector<std::pair<int, std::uint64_t>> entries(counts.begin(),
+                                                       counts.end());
+    std::stable_sort(entries.begin(),
+                     entries.end(),
+                     [](const auto& a, const auto& b) {
+                         return a.second > b.second;
+                     });
+    const std::uint64_t total = samples();
+    const std::size_t shown =
+      limit == 0 ? entries.size() : std::min(limit, entries.size());
+    const StreamFormat format(out);
+
+    out << "SAMPLES: " << total << " taken every " << interval_.count()
+        << "us, " << dropped() << " dropped\n";
+    out << std::setw(8) << "line" << std::setw(14) << "samples"
+        << std::setw(9) << "%" << "\n";
+    for (std::size_t i = 0; i < shown; ++i) {
+        const auto& [line, count] = entries[i];
+        out << std::setw(8) << line << std::setw(14) << count << std::setw(8)
+            << std::fixed << std::setprecision(2)
+            << (total ? 100.0 * static_cast<double>(count) / total : 0.0)
+            << "%\n";
+    }
+}
+
+/**
+ * write_folded
+ *
+ * Writes the histogram in the folded-stack format read by flame graph
+ * tools: one "root;frame count" record per line.
+ *
+ * @param path The file to write
+ * @param root Name of the bottom frame, usually the program's file name
+ * @return void
+ * @throws std::runtime_error If the file cannot be opened
+ */
+void Sampler::write_folded(std::string_view path, std::string_view root) const {
+    std::ofstream file(std::string(path), std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + std::string(path));
+    }
+    for (const auto& [line, count] : histogram()) {
+        file << root << ';';
+        if (line == 0) {
+            file << "startup";
+        } else {
+            file << "line_" << line;
+        }
+        file << ' ' << count << '\n';
+    }
+}
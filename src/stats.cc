@@ -0,0 +1,134 @@
+#include "../include/stats.h"
+#include "../include/stream_format.h"
+
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+/******************************************************************************/
+
+/**
+ * statement_name
+ *
+ * @param kind The statement kind to name
+ * @return The keyword that starts it
+ */
+const char* Stats::statement_name(Statement kind) noexcept {
+    switch (kind) {
+        case REM:
+            return "REM";
+        case PRINT:
+            return "PRINT";
+        case IF:
+            return "IF";
+        case GOTO:
+            return "GOTO";
+        case LET:
+            return "LET";
+        case ON:
+            return "ON";
+        case GOSUB:
+            return "GOSUB";
+        case RETURN:
+            return "RETURN";
+        case FOR:
+            return "FOR";
+        case NEXT:
+            return "NEXT";
+        case WHILE:
+            return "WHILE";
+        case WEND:
+            return "WEND";
+        case DIM:
+            return "DIM";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+/**
+ * total_statements
+ *
+ * @param void
+ * @return Statements executed, of every kind
+ */
+std::uint64_t Stats::total_statements() const noexcept {
+    std::uint64_t total = 0;
+    for (std::uint64_t count : statements) {
+        total += count;
+    }
+    return total;
+}
+
+/**
+ * report
+ *
+ * Prints the counters as a table. The tokens lexed per statement show how
+ * much of the lexing is rescanning rather than execution.
+ *
+ * @param out The stream to print to
+ * @return void
+ */
+void Stats::report(std::ostream& out) const {
+    const std::uint64_t total = total_statements();
+    const StreamFormat format(out);
+    auto row = [&out](const char* name, std::uint64_t value) {
+        out << "  " << std::left << std::setw(20) << name << std::right
+            << std::setw(14) << value << "\n";
+    };
+
+    out << "STATS:\n";
+    row("tokens lexed", tokens_lexed);
+    row("tokenizer resets", tokenizer_resets);
+    row("statements", total);
+    for (int kind = 0; kind < STATEMENT_KINDS; ++kind) {
+        out << "    " << std::left << std::setw(18)
+            << statement_name(static_cast<Statement>(kind)) << std::right
+            << std::setw(14) << statements[kind] << "\n";
+    }
+    row("jumps", jumps);
+    row("tokens skipped", tokens_skipped);
+    row("output bytes", output_bytes);
+    row("output flushes", output_flushes);
+    out << "  " << std::left << std::setw(20) << "tokens/statement"
+        << std::right << std::setw(14) << std::fixed << std::setprecision(2)
+        << (total ? static_cast<double>(tokens_lexed) / total : 0.0) << "\n";
+}
+
+/**
+ * write_json
+ *
+ * @param out The stream to write the JSON object to
+ * @return void
+ */
+void Stats::write_json(std::ostream& out) const {
+    out << "{\n  \"tokens_lexed\": " << tokens_lexed
+        << ",\n  \"tokenizer_resets\": " << tokenizer_resets
+        << ",\n  \"statements\": {";
+    for (int kind = 0; kind < STATEMENT_KINDS; ++kind) {
+        out << (kind ? ", \"" : " \"")
+            << statement_name(static_cast<Statement>(kind))
+            << "\": " << statements[kind];
+    }
+    out << " },\n  \"jumps\": " << jumps
+        << ",\n  \"tokens_skipped\": " << tokens_skipped
+        << ",\n  \"output_bytes\": " << output_bytes
+        << ",\n  \"output_flushes\": " << output_flushes << "\n}\n";
+}
+
+/**
+ * write
+ *
+ * @param path The file to write the JSON to
+ * @return void
+ * @throws std::runtime_error If the file cannot be opened
+ */
+void Stats::write(std::string_view path) const {
+    std::ofstream file(std::string(path), std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + std::string(path));
+    }
+    write_json(file);
+}
@@ -3,86 +3,294 @@
 #include "../include/tokenizer.h"
 
 #include <cctype>
+#include <charconv>
 #include <cstdio>
 #include <iostream>
 #include <stdexcept>
 #include <string_view>
+#include <vector>
 
 /**
  * Constructs a new SUBARUU object and initialize with the given source file.
  *
  * @param source The source code file.
+ * @param loading Whether the program is loaded whole, lazily or streamed
+ * @param window The size of the windows a program that is not loaded
+ *        whole is read in, 0 for the default
  * @throws std::runtime_error if tokenizer initialization fails
  */
-SUBARUU::SUBARUU(std::string_view source)
-  : tokenizer_(std::make_unique<Tokenizer>(source))
+SUBARUU::SUBARUU(std::string_view source,
+                 Tokenizer::Loading loading,
+                 std::size_t window)
+  : tokenizer_(std::make_unique<Tokenizer>(source, loading, window))
+  , cursor_(tokenizer_->begin())
+  , variables_{}
+  , arrays_{}
+  , returns_{}
+  , gosub_depth_(0)
+  , loops_{}
+  , loop_depth_(0)
+  , whiles_{}
+  , while_depth_(0)
+  , lines_mapped_(0)
+  , loaded_(false)
+  , line_hooks_(false)
   , execution_finished_(false)
-  , skip_to_line_(false)
-  , target_line_(-1) {
+  , current_line_(0) {
 
     if (!tokenizer_) {
         throw std::runtime_error("Failed to initialize Tokenizer");
     }
-
-    // Initialize all variables (a-z) to 0
-    for (char c = 'a'; c <= 'z'; ++c) {
-        variables_[c] = 0;
-    }
 }
 
 /**
  * Runs the SUBARUU interpreter.
+ *
+ * @throws std::runtime_error if the program fails, with error() as the
+ *         message
  */
 void SUBARUU::run() {
-    DEBUG_LOG("Starting program execution");
+    if (!try_run()) {
+        throw std::runtime_error(error_);
+    }
+}
+
+/**
+ * Runs the SUBARUU interpreter without throwing for a failed program,
+ * which is much cheaper for batch runners where many programs fail.
+ * Profiling started here is stopped again even when execution fails, so
+ * whatever was gathered can still be reported.
+ *
+ * @return false if the program failed; error() says why
+ */
+bool SUBARUU::try_run() {
+    if (sampler_) {
+        sampler_->start();
+    }
+    try {
+        execute();
+    } catch (...) {
+        stop_profiling();
+        throw;
+    }
+    stop_profiling();
+    return !failed();
+}
+
+/**
+ * Stops the profiler, the hardware counters, the tracer and the sampler,
+ * if enabled.
+ */
+void SUBARUU::stop_profiling() noexcept {
+    if (profiler_) {
+        profiler_->finish();
+    }
+    if (perf_counters_) {
+        perf_counters_->finish();
+    }
+    if (tracer_) {
+        tracer_->finish();
+    }
+    if (sampler_) {
+        sampler_->stop();
+    }
+}
+
+/**
+ * Prepares the program for execution by building the line map and, for
+ * a program loaded whole, linking its jumps to their targets. A jump to a
+ * line that does not exist fails the program here, before any of it runs.
+ * run() does this itself when it has not been done yet; calling it
+ * separately lets the load cost be measured on its own. The map of a
+ * lazily loaded program holds the lines read so far and grows as it runs;
+ * a streamed program has none, its lines are found as it runs.
+ */
+void SUBARUU::load() {
+    Tracer::Span span(tracer_.get(), "load", "load");
+    if (!tokenizer_->streaming()) {
+        build_line_map();
+    }
+    if (tokenizer_->loading() == Tokenizer::Loading::WHOLE) {
+        link();
+    }
+    loaded_ = true;
+}
+
+/**
+ * Loads the program if needed and executes it until it finishes.
+ */
+void SUBARUU::execute() {
+    TRACE_LOG(PARSER, "Starting program execution");
 
     // Build line map at start
-    build_line_map();
+    if (!loaded_) {
+        load();
+    }
 
     while (!finished()) {
-        if (tokenizer_->finished()) {
+        if (cursor_.at_end() && !next_window()) {
             execution_finished_ = true;
             break;
         }
 
-        if (skip_to_line_) {
-            // We're looking for a specific line
-            auto token = tokenizer_->current_token();
-            if (token == Tokenizer::TokenType::NUMBER) {
-                int current_line = tokenizer_->get_num();
-                if (current_line == target_line_) {
-                    skip_to_line_ = false;
-                    target_line_ = -1;
-                    tokenizer_->next_token(); // Move past the line number
-                    statement();
-                } else {
-                    // Skip to next line
-                    while (tokenizer_->current_token() !=
-                             Tokenizer::TokenType::EOL &&
-                           !tokenizer_->finished()) {
-                        tokenizer_->next_token();
-                    }
-                    if (tokenizer_->current_token() ==
-                        Tokenizer::TokenType::EOL) {
-                        tokenizer_->next_token();
-                    }
-                }
-            } else {
-                // Skip non-numbered lines while searching
-                while (tokenizer_->current_token() !=
-                         Tokenizer::TokenType::EOL &&
-                       !tokenizer_->finished()) {
-                    tokenizer_->next_token();
-                }
-                if (tokenizer_->current_token() == Tokenizer::TokenType::EOL) {
-                    tokenizer_->next_token();
-                }
-            }
-        } else {
-            line_statement();
+        line_statement();
+    }
+    TRACE_LOG(PARSER, "Program execution finished");
+}
+
+/**
+ * Turns on per-line profiling for the next run().
+ * Every line entered is counted and charged the cycles spent until the
+ * next line is entered; while it is off the hook is a single branch.
+ */
+void SUBARUU::enable_profiler() {
+    if (!profiler_) {
+        profiler_ = std::make_unique<Profiler>();
+    }
+    line_hooks_ = true;
+}
+
+/**
+ * Turns on SIGPROF sampling for the next run().
+ * The signal handler only reads current_line_, which every line entered
+ * stores with a relaxed atomic write.
+ *
+ * @param interval CPU time between two samples
+ */
+void SUBARUU::enable_sampler(std::chrono::microseconds interval) {
+    sampler_ = std::make_unique<Sampler>(current_line_, interval);
+}
+
+/**
+ * Opens cycles, instructions, branch-miss and cache-miss counters for the
+ * calling thread, which must be the one that calls run(). The deltas
+ * between two lines entered are charged to the first of them. When the
+ * kernel denies every counter the run goes ahead uncounted and
+ * perf_counters()->error() says why.
+ *
+ * @return true if at least one counter could be opened
+ */
+bool SUBARUU::enable_perf_counters() {
+    if (!perf_counters_) {
+        perf_counters_ = std::make_unique<PerfCounters>();
+    }
+    line_hooks_ = true;
+    return perf_counters_->available() || perf_counters_->open();
+}
+
+/**
+ * Starts writing a trace-event file for the next load() and run(). The
+ * trace has spans for load and build_line_map, one span per line block
+ * (the lines entered between two jumps) and one per output flush. On
+ * billion-step runs sample_every and max_events keep the file to a size a
+ * trace viewer can open.
+ *
+ * @param path The trace file to write
+ * @param sample_every Keep one line block and one flush in this many
+ * @param max_events Events past this many are dropped and counted
+ * @throws std::runtime_error If the file cannot be opened
+ */
+void SUBARUU::enable_tracer(std::string_view path,
+                            std::uint64_t sample_every,
+                            std::uint64_t max_events) {
+    tracer_ = std::make_unique<Tracer>(path, sample_every, max_events);
+    line_hooks_ = true;
+}
+
+/**
+ * Hands a line entered to the profiler, the hardware counters and the
+ * tracer; enter_line() only calls it when one of them is enabled.
+ *
+ * @param line The line that starts running
+ */
+void SUBARUU::run_line_hooks(int line) {
+    if (profiler_) {
+        profiler_->enter(line);
+    }
+    if (perf_counters_) {
+        perf_counters_->enter(line);
+    }
+    if (tracer_) {
+        tracer_->line(line);
+    }
+}
+
+/**
+ * Counts a jump taken and ends the tracer's line block.
+ */
+void SUBARUU::jumped() {
+    ++stats_.jumps;
+    TRACE_LOG(JUMPS,
+              "Jump from line "
+                << current_line_.load(std::memory_order_relaxed));
+    if (tracer_) [[unlikely]] {
+        tracer_->jump();
+    }
+}
+
+/**
+ * Moves the cursor back to the first token.
+ */
+void SUBARUU::rewind() {
+    cursor_.reset();
+    ++stats_.tokenizer_resets;
+}
+
+/**
+ * Moves on to the next window of a program not loaded whole.
+ *
+ * @return false at the end of the program, or once it has failed
+ */
+bool SUBARUU::next_window() {
+    if (failed() || !tokenizer_->next_window()) {
+        return false;
+    }
+    cursor_ = tokenizer_->cursor();
+    if (!tokenizer_->streaming()) {
+        map_lines();
+    }
+    return true;
+}
+
+/**
+ * Jumps to a line of a streamed program. A line already lexed is found in
+ * the current window or through the tokenizer's line index; any other is
+ * looked for by reading on, and is missing if the program ends first.
+ *
+ * @param line_number The line to jump to
+ * @param target Index of the jump's line number token, for the error
+ */
+void SUBARUU::stream_jump(int line_number, std::size_t target) {
+    if (failed()) {
+        return;
+    }
+    jumped();
+    if (!tokenizer_->find_line(line_number)) {
+        // The window holding the target token is about to be replaced
+        const Tokenizer::Location where = tokenizer_->location(target);
+        if (!tokenizer_->scan_to_line(line_number)) {
+            cursor_ = tokenizer_->cursor();
+            dprintf("Runtime Error: Line number " +
+                      std::to_string(line_number) + " not found",
+                    E_ERROR,
+                    where);
+            return;
         }
     }
-    DEBUG_LOG("Program execution finished");
+    cursor_ = tokenizer_->cursor();
+    enter_line(line_number);
+    cursor_.next(); // Skip past the line number
+}
+
+/**
+ * Gathers the interpreter's counters with the tokenizer's.
+ *
+ * @return A snapshot of every counter so far
+ */
+Stats SUBARUU::stats() const {
+    Stats snapshot = stats_;
+    snapshot.tokens_lexed = tokenizer_->tokens_lexed();
+    return snapshot;
 }
 
 /**
@@ -104,37 +312,89 @@ std::string SUBARUU::get_token_string(Tokenizer::TokenType token) const {
 bool SUBARUU::finished() const { return execution_finished_; }
 
 /**
- * Debug print function with error handling.
- * Prints message to stderr and throws for errors but not warnings.
+ * Debug print function with error handling, for the current token.
  *
  * @param message The message to print
  * @param errorCode E_ERROR or E_WARNING
- * @throws std::runtime_error if errorCode is E_ERROR
  */
 void SUBARUU::dprintf(const std::string& message, int errorCode) {
+    dprintf(message, errorCode, tokenizer_->location(cursor_.offset()));
+}
+
+/**
+ * Debug print function with error handling.
+ * Prints message to stderr, prefixed with the file, source line and
+ * column of the token it is about. An error is recorded rather than
+ * thrown: the cursor moves to the EOF sentinel, so every parsing loop
+ * winds down on its own, and run() throws once execution has stopped.
+ * Only the first error is kept; the ones that follow from it are not
+ * reported.
+ *
+ * @param message The message to print
+ * @param errorCode E_ERROR or E_WARNING
+ * @param where Where the token starts in the source
+ */
+void SUBARUU::dprintf(const std::string& message,
+                      int errorCode,
+                      Tokenizer::Location where) {
+    if (failed()) {
+        return;
+    }
+    const std::string located = locate(message, where);
     if (errorCode == E_ERROR) {
-        std::cerr << "ERROR: " << message << std::endl;
-        throw std::runtime_error(message);
+        std::cerr << "ERROR: " << located << std::endl;
+        error_ = located;
+        execution_finished_ = true;
+        cursor_.seek(cursor_.size());
     } else {
-        std::cerr << "WARNING: " << message << std::endl;
+        std::cerr << "WARNING: " << located << std::endl;
     }
 }
 
+/**
+ * Prefixes a message with the file, source line and column it is about.
+ *
+ * @param message The message
+ * @param where Where the token it is about starts in the source
+ * @return The located message
+ */
+std::string SUBARUU::locate(const std::string& message,
+                            Tokenizer::Location where) const {
+    return std::string(tokenizer_->file()) + ":" +
+           std::to_string(where.line) + ":" + std::to_string(where.column) +
+           ": " + message;
+}
+
 /**
  * Accepts the expected token or reports an error.
  *
  * @param expectedToken The token type that should be next in the stream
- * @throws std::runtime_error if the current token doesn't match expected
  */
 void SUBARUU::accept(Tokenizer::TokenType expectedToken) {
-    if (tokenizer_->current_token() != expectedToken) {
-        std::string error = "*subaruu.cpp: unexpected `" +
-                            get_token_string(tokenizer_->current_token()) +
+    if (cursor_->type != expectedToken) {
+        std::string error = "Syntax Error: unexpected `" +
+                            get_token_string(cursor_->type) +
                             "` expected `" + get_token_string(expectedToken) +
                             "`";
         dprintf(error, E_ERROR);
     }
-    tokenizer_->next_token();
+    cursor_.next();
+}
+
+/**
+ * Accepts the end of a statement: the end of its line, or the ':' before
+ * the next statement on it. The end of a last line with no newline is
+ * left for line_statement() to find.
+ */
+void SUBARUU::end_statement() {
+    if (cursor_->type == Tokenizer::TokenType::COLON) {
+        cursor_.next();
+        return;
+    }
+    if (cursor_->type == Tokenizer::TokenType::EOF_TOKEN) {
+        return;
+    }
+    accept(Tokenizer::TokenType::EOL);
 }
 
 /**
@@ -142,37 +402,44 @@ void SUBARUU::accept(Tokenizer::TokenType expectedToken) {
  * A factor can be:
  * - A number
  * - A variable
+ * - An array element
  * - A parenthesized expression
  *
  * @return int The evaluated value of the factor
- * @throws std::runtime_error on syntax errors
  */
 int SUBARUU::factor() {
     int result = 0;
-    const auto token = tokenizer_->current_token();
+    const auto token = cursor_->type;
 
     switch (token) {
         case Tokenizer::TokenType::NUMBER:
-            result = tokenizer_->get_num();
-            DEBUG_LOG("Factor number: " << result);
-            tokenizer_->next_token();
+            result = cursor_->value;
+            TRACE_LOG(PARSER, "Factor number: " << result);
+            cursor_.next();
             break;
 
-        case Tokenizer::TokenType::LETTER: {
-            char var_name =
-              std::tolower(std::get<char>(tokenizer_->get_token_data()));
-            DEBUG_LOG("Factor variable " << var_name);
-
-            auto it = variables_.find(var_name);
-            result = (it != variables_.end()) ? it->second : 0;
-
-            DEBUG_LOG(" = " << result);
-            tokenizer_->next_token();
+        case Tokenizer::TokenType::LETTER:
+            if (cursor_.peek().type == Tokenizer::TokenType::LEFT_PAREN) {
+                const int slot = cursor_->value;
+                const std::size_t at = cursor_.offset();
+                cursor_.next();
+                const int* cell = element(slot, at);
+                result = cell ? *cell : 0;
+                TRACE_LOG(VARIABLES,
+                          "Factor element of " << static_cast<char>('a' + slot)
+                                               << " = " << result);
+                break;
+            }
+            result = variables_[cursor_->value];
+            TRACE_LOG(VARIABLES,
+                      "Factor variable "
+                        << static_cast<char>('a' + cursor_->value)
+                        << " = " << result);
+            cursor_.next();
             break;
-        }
 
         case Tokenizer::TokenType::LEFT_PAREN:
-            tokenizer_->next_token(); // Consume '('
+            cursor_.next(); // Consume '('
             result = expression();
             accept(Tokenizer::TokenType::RIGHT_PAREN);
             break;
@@ -193,15 +460,15 @@ int SUBARUU::factor() {
  * @return int The evaluated term value
  */
 int SUBARUU::term() {
-    DEBUG_LOG("Starting term evaluation");
+    TRACE_LOG(PARSER, "Starting term evaluation");
 
     int result = factor();
-    auto token = tokenizer_->current_token();
-    DEBUG_LOG("Term token: " << get_token_string(token));
+    auto token = cursor_->type;
+    TRACE_LOG(PARSER, "Term token: " << get_token_string(token));
 
     while (token == Tokenizer::TokenType::ASTERISK ||
            token == Tokenizer::TokenType::SLASH) {
-        tokenizer_->next_token();
+        cursor_.next();
         int factor_value = factor();
 
         if (token == Tokenizer::TokenType::ASTERISK) {
@@ -210,7 +477,7 @@ int SUBARUU::term() {
             result = safe_divide(result, factor_value);
         }
 
-        token = tokenizer_->current_token();
+        token = cursor_->type;
     }
 
     return result;
@@ -224,22 +491,21 @@ int SUBARUU::term() {
  * @return int The evaluated expression value
  */
 int SUBARUU::expression() {
-    DEBUG_LOG("Starting expression evaluation");
+    TRACE_LOG(PARSER, "Starting expression evaluation");
 
     int result = term();
-    auto token = tokenizer_->current_token();
-    DEBUG_LOG("Expression token after term: " << get_token_string(token));
+    auto token = cursor_->type;
+    TRACE_LOG(PARSER,
+              "Expression token after term: " << get_token_string(token));
 
     // Check for potential line number
-    if (token == Tokenizer::TokenType::NUMBER) {
-        if (is_valid_line_number(tokenizer_->get_num())) {
-            return result;
-        }
+    if (is_line_number()) {
+        return result;
     }
 
     while (token == Tokenizer::TokenType::PLUS ||
            token == Tokenizer::TokenType::MINUS) {
-        tokenizer_->next_token();
+        cursor_.next();
         int term_value = term();
 
         if (token == Tokenizer::TokenType::PLUS) {
@@ -248,30 +514,12 @@ int SUBARUU::expression() {
             result -= term_value;
         }
 
-        token = tokenizer_->current_token();
+        token = cursor_->type;
     }
 
     return result;
 }
 
-/**
- * Helper to determine if a number could be a valid line number.
- * Line numbers must be >= 10 and multiples of 10, followed by whitespace.
- *
- * @param num The number to check
- * @return bool True if this appears to be a line number
- */
-bool SUBARUU::is_valid_line_number(int num) const {
-    if (num >= 10 && num % 10 == 0) {
-        if (tokenizer_->finished()) {
-            return true; // EOF after line number is acceptable
-        }
-        char next_char = tokenizer_->peek_char();
-        return (next_char == ' ' || next_char == '\n' || next_char == '\r');
-    }
-    return false;
-}
-
 /**
  * Performs safe division with error handling.
  *
@@ -282,12 +530,12 @@ bool SUBARUU::is_valid_line_number(int num) const {
 int SUBARUU::safe_divide(int numerator, int denominator) {
     if (denominator == 0) {
         dprintf("*warning: divide by zero", E_WARNING);
-        DEBUG_LOG("Division by zero detected, setting result to 0");
+        TRACE_LOG(PARSER, "Division by zero detected, setting result to 0");
         return 0;
     }
 
     int result = numerator / denominator;
-    DEBUG_LOG("Division result: " << result);
+    TRACE_LOG(PARSER, "Division result: " << result);
     return result;
 }
 
@@ -297,16 +545,15 @@ int SUBARUU::safe_divide(int numerator, int denominator) {
  * Non-zero values in simple expressions are treated as true.
  *
  * @return int 1 for true, 0 for false
- * @throws std::runtime_error on invalid comparison operator
  */
 int SUBARUU::relation() {
-    DEBUG_LOG("Starting relation evaluation");
+    TRACE_LOG(PARSER, "Starting relation evaluation");
 
     int left = expression();
-    DEBUG_LOG("Left side of relation: " << left);
+    TRACE_LOG(PARSER, "Left side of relation: " << left);
 
-    auto token = tokenizer_->current_token();
-    DEBUG_LOG("Relation operator: " << get_token_string(token));
+    auto token = cursor_->type;
+    TRACE_LOG(PARSER, "Relation operator: " << get_token_string(token));
 
     // Check if this is a comparison operation
     switch (token) {
@@ -317,10 +564,10 @@ int SUBARUU::relation() {
         case Tokenizer::TokenType::GT_EQ:
         case Tokenizer::TokenType::NOT_EQUAL: {
             auto op = token;
-            tokenizer_->next_token();
+            cursor_.next();
 
             int right = expression();
-            DEBUG_LOG("Right side of relation: " << right);
+            TRACE_LOG(PARSER, "Right side of relation: " << right);
 
             // Evaluate comparison
             switch (op) {
@@ -351,157 +598,590 @@ int SUBARUU::relation() {
 
 /**
  * Executes a LET statement.
- * Format: LET variable = expression
- *
- * @throws std::runtime_error on syntax errors
+ * Format: LET variable[(expression)] = expression
  */
 void SUBARUU::let_statement() {
-    DEBUG_LOG("Processing LET statement");
+    TRACE_LOG(PARSER, "Processing LET statement");
 
     // Get variable name
-    auto token = tokenizer_->current_token();
+    auto token = cursor_->type;
     if (token != Tokenizer::TokenType::LETTER) {
-        DEBUG_LOG("Expected LETTER, got: " << get_token_string(token));
+        TRACE_LOG(PARSER, "Expected LETTER, got: " << get_token_string(token));
         dprintf("Syntax Error: Expected variable name", E_ERROR);
         return;
     }
 
-// Process variable
-#ifdef DEBUG_MODE
-    int var_index = tokenizer_->variable_num();
-    char var_name = std::tolower(std::get<char>(tokenizer_->get_token_data()));
-    DEBUG_LOG("Variable name: " << var_name << " (index: " << var_index << ")");
-#else
-    char var_name = std::tolower(std::get<char>(tokenizer_->get_token_data()));
-#endif
+    // Process variable
+    const int slot = cursor_->value;
+    const char var_name = static_cast<char>('a' + slot);
+    TRACE_LOG(VARIABLES,
+              "Variable name: " << var_name << " (index: " << slot << ")");
+
+    const std::size_t at = cursor_.offset();
+    cursor_.next();
 
-    tokenizer_->next_token();
+    // An element of the variable's array instead
+    int* target = &variables_[slot];
+    if (cursor_->type == Tokenizer::TokenType::LEFT_PAREN) {
+        target = element(slot, at);
+        if (!target) {
+            return;
+        }
+    }
 
     // Verify and consume equals sign
     accept(Tokenizer::TokenType::EQUAL);
 
     // Evaluate the expression
-    DEBUG_LOG("Evaluating expression");
+    TRACE_LOG(PARSER, "Evaluating expression");
     int value = expression();
 
     // Store the value
-    variables_[var_name] = value;
+    *target = value;
 
-#ifdef DEBUG_MODE
-    DEBUG_LOG("Stored value " << value << " in variable " << var_name
-                              << " at index " << var_index);
-#endif
+    TRACE_LOG(VARIABLES,
+              "Stored value " << value << " in variable " << var_name);
 }
+
+/**
+ * Executes a DIM statement.
+ * Format: DIM variable(expression)[, variable(expression)]...
+ * Gives each variable an array of elements 0 to the expression's value,
+ * all zero. A variable's array is apart from its number, and is only
+ * dimensioned once.
+ */
+void SUBARUU::dim_statement() {
+    accept(Tokenizer::TokenType::DIM);
+    while (!failed()) {
+        const std::size_t at = cursor_.offset();
+        if (cursor_->type != Tokenizer::TokenType::LETTER) {
+            dprintf("Syntax Error: Expected array name", E_ERROR);
+            return;
+        }
+        const int slot = cursor_->value;
+        const std::string name(1, static_cast<char>('a' + slot));
+        cursor_.next();
+        accept(Tokenizer::TokenType::LEFT_PAREN);
+        const int last = expression();
+        accept(Tokenizer::TokenType::RIGHT_PAREN);
+        if (failed()) {
+            return;
+        }
+
+        Array& array = arrays_[slot];
+        if (array.data) {
+            dprintf("Runtime Error: Array " + name + " dimensioned twice",
+                    E_ERROR,
+                    tokenizer_->location(at));
+            return;
+        }
+        if (last < 0 ||
+            static_cast<std::size_t>(last) >= SUBARUU_ARRAY_MAX) {
+            dprintf("Runtime Error: Array " + name + " cannot have " +
+                      std::to_string(static_cast<long long>(last) + 1) +
+                      " elements",
+                    E_ERROR,
+                    tokenizer_->location(at));
+            return;
+        }
+        const auto size = static_cast<std::uint32_t>(last) + 1;
+        array = { arena_.allocate(size), size };
+        TRACE_LOG(VARIABLES, "Dimensioned " << name << "(0 to " << last << ")");
+
+        if (cursor_->type != Tokenizer::TokenType::SEPARATOR) {
+            break;
+        }
+        cursor_.next();
+    }
+    end_statement();
+}
+
+/**
+ * Reads the index of an array element, from the '(' after the array's
+ * name to the ')', and checks it against the array's size. The check is
+ * a single unsigned compare, which a negative index fails too, as does
+ * any index of an array not dimensioned.
+ *
+ * @param slot The array's variable
+ * @param at Index of the array's name token, for errors
+ * @return The element, or nullptr once the program has failed
+ */
+int* SUBARUU::element(int slot, std::size_t at) {
+    accept(Tokenizer::TokenType::LEFT_PAREN);
+    const int index = expression();
+    accept(Tokenizer::TokenType::RIGHT_PAREN);
+    if (failed()) {
+        return nullptr;
+    }
+    const Array& array = arrays_[slot];
+    if (static_cast<std::uint32_t>(index) >= array.size) [[unlikely]] {
+        const std::string name(1, static_cast<char>('a' + slot));
+        dprintf(array.data ? "Runtime Error: Index " + std::to_string(index) +
+                               " is out of range for " + name + "(0 to " +
+                               std::to_string(array.size - 1) + ")"
+                           : "Runtime Error: Array " + name +
+                               " is not dimensioned",
+                E_ERROR,
+                tokenizer_->location(at));
+        return nullptr;
+    }
+    return array.data + index;
+}
+
 /**
  * Executes an IF statement.
  * Format: IF condition THEN line_number
- *
- * @throws std::runtime_error on syntax errors
+ * A false condition skips the rest of the line, as classic BASIC does,
+ * statements after a ':' included.
  */
 
 void SUBARUU::if_statement() {
-    DEBUG_LOG("Processing IF statement");
+    TRACE_LOG(PARSER, "Processing IF statement");
     accept(Tokenizer::TokenType::IF);
     int condition = relation();
-    DEBUG_LOG("Condition result: " << condition);
+    TRACE_LOG(JUMPS, "Condition result: " << condition);
     accept(Tokenizer::TokenType::THEN);
 
-    if (tokenizer_->current_token() != Tokenizer::TokenType::NUMBER) {
+    if (cursor_->type != Tokenizer::TokenType::NUMBER) {
         dprintf("Syntax Error: Expected line number after THEN", E_ERROR);
         return;
     }
 
-    int line_number = tokenizer_->get_num();
-    tokenizer_->next_token();
+    const Tokenizer::Token line_number = *cursor_;
+    const std::size_t target = cursor_.offset();
+    cursor_.next();
 
     if (condition) {
-        DEBUG_LOG("Condition true, jumping to line " << line_number);
-        if (line_positions_.find(line_number) == line_positions_.end()) {
-            dprintf("Runtime Error: Line number " +
-                      std::to_string(line_number) + " not found",
-                    E_ERROR);
-            return;
-        }
-
-        tokenizer_->reset();
-        if (!find_target_line(line_number)) {
-            dprintf("Internal Error: Failed to find valid line number " +
-                      std::to_string(line_number),
-                    E_ERROR);
+        TRACE_LOG(JUMPS, "Condition true, jumping");
+        if (line_number.flags & Tokenizer::LINKED) {
+            jump_to(static_cast<std::uint32_t>(line_number.value));
+        } else {
+            jump_to_line(line_number.value, target);
         }
     } else {
-        // If condition is false, continue to next statement
-        if (tokenizer_->current_token() == Tokenizer::TokenType::EOL) {
-            tokenizer_->next_token();
+        // If condition is false, skip the rest of the line, ':'s and all
+        while (!cursor_.at_end() &&
+               cursor_->type != Tokenizer::TokenType::EOL) {
+            cursor_.advance();
         }
+        cursor_.next();
     }
 }
 
 /**
  * Executes a GOTO statement.
- * Format: GOTO line_number
+ * Format: GOTO expression
  */
 
 void SUBARUU::goto_statement() {
     accept(Tokenizer::TokenType::GOTO);
-    int line_number = tokenizer_->get_num();
-    accept(Tokenizer::TokenType::NUMBER);
-    accept(Tokenizer::TokenType::EOL);
+    const Tokenizer::Token line_number = *cursor_;
+    const std::size_t target = cursor_.offset();
+    if (line_number.flags & Tokenizer::LINKED) {
+        cursor_.next();
+        end_statement();
+        jump_to(static_cast<std::uint32_t>(line_number.value));
+        return;
+    }
+    const int line = expression();
+    end_statement();
+    jump_to_line(line, target);
+}
 
-    if (line_positions_.find(line_number) == line_positions_.end()) {
-        dprintf("Runtime Error: Line number " + std::to_string(line_number) +
-                  " not found",
-                E_ERROR);
+/**
+ * Executes an ON statement.
+ * Format: ON expression GOTO line_number, line_number, ...
+ * Jumps to the first line when the expression is 1, to the second when it
+ * is 2 and so on, and goes on to the next line when the list is shorter.
+ */
+void SUBARUU::on_statement() {
+    accept(Tokenizer::TokenType::ON);
+    const int choice = expression();
+    const Tokenizer::Token list = *cursor_;
+    const std::size_t go = cursor_.offset();
+    accept(Tokenizer::TokenType::GOTO);
+    if (failed()) {
         return;
     }
 
-    tokenizer_->reset();
-    if (!find_target_line(line_number)) {
-        dprintf("Internal Error: Failed to find valid line number " +
-                  std::to_string(line_number),
-                E_ERROR);
+    if (list.flags & Tokenizer::LINKED) {
+        // The targets are every other token after the GOTO
+        if (choice >= 1 && choice <= list.value) {
+            cursor_.seek(go + 2 * static_cast<std::size_t>(choice) - 1);
+            jump_to(static_cast<std::uint32_t>(cursor_->value));
+            return;
+        }
+        cursor_.seek(go + 2 * static_cast<std::size_t>(list.value));
+        end_statement();
+        return;
+    }
+
+    for (int position = 1; !failed(); ++position) {
+        const Tokenizer::Token line_number = *cursor_;
+        const std::size_t target = cursor_.offset();
+        accept(Tokenizer::TokenType::NUMBER);
+        if (position == choice) {
+            jump_to_line(line_number.value, target);
+            return;
+        }
+        if (cursor_->type != Tokenizer::TokenType::SEPARATOR) {
+            break;
+        }
+        cursor_.next();
     }
+    end_statement();
 }
 
 /**
- * Skips through the code until finding a specific line number.
- * Assumes tokenizer has been reset to beginning.
- *
- * @param line_number The target line number to find
- * @return bool True if line was found, false if reached end without finding
+ * Executes a GOSUB statement.
+ * Format: GOSUB expression
+ * Jumps like GOTO, after pushing the position of the statement that
+ * follows onto the return stack.
  */
-bool SUBARUU::find_target_line(int line_number) {
-    while (!tokenizer_->finished()) {
-        if (tokenizer_->current_token() == Tokenizer::TokenType::NUMBER &&
-            tokenizer_->get_num() == line_number) {
-            tokenizer_->next_token(); // Skip past the line number
-            return true;
+void SUBARUU::gosub_statement() {
+    const std::size_t gosub = cursor_.offset();
+    accept(Tokenizer::TokenType::GOSUB);
+    const Tokenizer::Token line_number = *cursor_;
+    const std::size_t target = cursor_.offset();
+    int line = 0;
+    if (line_number.flags & Tokenizer::LINKED) {
+        cursor_.next();
+    } else {
+        line = expression();
+    }
+    end_statement();
+    if (failed()) {
+        return;
+    }
+    if (gosub_depth_ == returns_.size()) {
+        dprintf("Runtime Error: GOSUB nested deeper than " +
+                  std::to_string(returns_.size()),
+                E_ERROR,
+                tokenizer_->location(gosub));
+        return;
+    }
+    returns_[gosub_depth_++] = tokenizer_->mark(cursor_.offset());
+    if (line_number.flags & Tokenizer::LINKED) {
+        jump_to(static_cast<std::uint32_t>(line_number.value));
+    } else {
+        jump_to_line(line, target);
+    }
+}
+
+/**
+ * Executes a RETURN statement.
+ * Format: RETURN
+ * Goes back to the statement after the last GOSUB.
+ */
+void SUBARUU::return_statement() {
+    const std::size_t at = cursor_.offset();
+    accept(Tokenizer::TokenType::RETURN);
+    end_statement();
+    if (failed()) {
+        return;
+    }
+    if (gosub_depth_ == 0) {
+        dprintf("Runtime Error: RETURN without GOSUB",
+                E_ERROR,
+                tokenizer_->location(at));
+        return;
+    }
+    jumped();
+    restore(returns_[--gosub_depth_]);
+}
+
+/**
+ * Executes a FOR statement.
+ * Format: FOR variable = expression TO expression [STEP expression]
+ * The limit and the step are evaluated once, into the loop's frame along
+ * with the position of the statement after the FOR, which every NEXT
+ * goes back to. A loop that runs no times goes on after its NEXT.
+ */
+void SUBARUU::for_statement() {
+    const Tokenizer::Token loop = *cursor_;
+    const Tokenizer::Location where = tokenizer_->location(cursor_.offset());
+    accept(Tokenizer::TokenType::FOR);
+    if (cursor_->type != Tokenizer::TokenType::LETTER) {
+        dprintf("Syntax Error: Expected variable name", E_ERROR);
+        return;
+    }
+    const int slot = cursor_->value;
+    cursor_.next();
+    accept(Tokenizer::TokenType::EQUAL);
+    const int first = expression();
+    accept(Tokenizer::TokenType::TO);
+    const int limit = expression();
+    int step = 1;
+    if (cursor_->type == Tokenizer::TokenType::STEP) {
+        cursor_.next();
+        step = expression();
+    }
+    end_statement();
+    if (failed()) {
+        return;
+    }
+    variables_[slot] = first;
+
+    if (step >= 0 ? first > limit : first < limit) {
+        TRACE_LOG(JUMPS, "FOR runs no times, going on after its NEXT");
+        if (loop.flags & Tokenizer::LINKED) {
+            cursor_.seek(static_cast<std::size_t>(loop.value));
+        } else if (skip_loop(Tokenizer::TokenType::FOR,
+                             Tokenizer::TokenType::NEXT)) {
+            cursor_.next();
+            if (cursor_->type == Tokenizer::TokenType::LETTER) {
+                cursor_.next();
+            }
+        } else {
+            dprintf("Runtime Error: FOR without NEXT", E_ERROR, where);
+            return;
         }
+        end_statement();
+        return;
+    }
 
-        // Skip to end of current line
-        while (!tokenizer_->finished() &&
-               tokenizer_->current_token() != Tokenizer::TokenType::EOL) {
-            tokenizer_->next_token();
+    // Going into a loop again replaces it, and the loops inside it
+    for (std::size_t depth = loop_depth_; depth > 0; --depth) {
+        if (loops_[depth - 1].slot == slot) {
+            loop_depth_ = depth - 1;
+            break;
         }
+    }
+    if (loop_depth_ == loops_.size()) {
+        dprintf("Runtime Error: FOR loops nested deeper than " +
+                  std::to_string(loops_.size()),
+                E_ERROR,
+                where);
+        return;
+    }
+    loops_[loop_depth_++] = {
+        slot, limit, step, tokenizer_->mark(cursor_.offset())
+    };
+}
 
-        if (tokenizer_->current_token() == Tokenizer::TokenType::EOL) {
-            tokenizer_->next_token();
+/**
+ * Executes a NEXT statement.
+ * Format: NEXT [variable]
+ * Steps the counter of the innermost loop and goes back to its body
+ * until the counter passes the limit.
+ */
+void SUBARUU::next_statement() {
+    const std::size_t at = cursor_.offset();
+    accept(Tokenizer::TokenType::NEXT);
+    int slot = -1;
+    if (cursor_->type == Tokenizer::TokenType::LETTER) {
+        slot = cursor_->value;
+        cursor_.next();
+    }
+    end_statement();
+    if (failed()) {
+        return;
+    }
+    if (loop_depth_ == 0) {
+        dprintf("Runtime Error: NEXT without FOR",
+                E_ERROR,
+                tokenizer_->location(at));
+        return;
+    }
+    const Loop& loop = loops_[loop_depth_ - 1];
+    if (slot >= 0 && slot != loop.slot) {
+        dprintf(std::string("Runtime Error: NEXT ") +
+                  static_cast<char>('a' + slot) + " does not match FOR " +
+                  static_cast<char>('a' + loop.slot),
+                E_ERROR,
+                tokenizer_->location(at));
+        return;
+    }
+
+    int& counter = variables_[loop.slot];
+    counter += loop.step;
+    if (loop.step >= 0 ? counter > loop.limit : counter < loop.limit) {
+        --loop_depth_;
+        return;
+    }
+    jumped();
+    restore(loop.body);
+}
+
+/**
+ * Executes a WHILE statement.
+ * Format: WHILE condition
+ * The body runs while the condition holds; once it does not, the program
+ * goes on after the loop's WEND. A loop linked at load knows where that
+ * is; any other remembers where it starts as it runs and skips ahead to
+ * get out.
+ */
+void SUBARUU::while_statement() {
+    const Tokenizer::Token loop = *cursor_;
+    const std::size_t at = cursor_.offset();
+    accept(Tokenizer::TokenType::WHILE);
+    const int condition = relation();
+    TRACE_LOG(JUMPS, "Condition result: " << condition);
+    end_statement();
+    if (failed()) {
+        return;
+    }
+    if (loop.flags & Tokenizer::LINKED) {
+        if (!condition) {
+            cursor_.seek(static_cast<std::size_t>(loop.value));
+            end_statement();
+        }
+        return;
+    }
+
+    // Going into a loop again replaces it, and the loops inside it
+    const Tokenizer::Mark head = tokenizer_->mark(while_head(at));
+    for (std::size_t depth = while_depth_; depth > 0; --depth) {
+        if (whiles_[depth - 1] == head) {
+            while_depth_ = depth - 1;
+            break;
+        }
+    }
+    if (condition) {
+        if (while_depth_ == whiles_.size()) {
+            dprintf("Runtime Error: WHILE loops nested deeper than " +
+                      std::to_string(whiles_.size()),
+                    E_ERROR,
+                    tokenizer_->location(at));
+            return;
+        }
+        whiles_[while_depth_++] = head;
+        return;
+    }
+    const Tokenizer::Location where = tokenizer_->location(at);
+    if (!skip_loop(Tokenizer::TokenType::WHILE, Tokenizer::TokenType::WEND)) {
+        dprintf("Runtime Error: WHILE without WEND", E_ERROR, where);
+        return;
+    }
+    cursor_.next();
+    end_statement();
+}
+
+/**
+ * Executes a WEND statement.
+ * Format: WEND
+ * Goes back to the WHILE of the innermost loop to test its condition
+ * again.
+ */
+void SUBARUU::wend_statement() {
+    const Tokenizer::Token wend = *cursor_;
+    const std::size_t at = cursor_.offset();
+    accept(Tokenizer::TokenType::WEND);
+    end_statement();
+    if (failed()) {
+        return;
+    }
+    if (wend.flags & Tokenizer::LINKED) {
+        jumped();
+        cursor_.seek(static_cast<std::size_t>(wend.value));
+        return;
+    }
+    if (while_depth_ == 0) {
+        dprintf("Runtime Error: WEND without WHILE",
+                E_ERROR,
+                tokenizer_->location(at));
+        return;
+    }
+    jumped();
+    restore(whiles_[--while_depth_]);
+}
+
+/**
+ * Skips ahead to the statement that closes the loop being entered, for
+ * a program whose loops were not linked at load.
+ *
+ * @param open The keyword that opens a loop
+ * @param close The keyword that closes one
+ * @return true, with the cursor on the closing keyword, unless the
+ *         program ends first
+ */
+bool SUBARUU::skip_loop(Tokenizer::TokenType open,
+                        Tokenizer::TokenType close) {
+    int depth = 0;
+    while (!failed()) {
+        if (cursor_.at_end() && !next_window()) {
+            return false;
+        }
+        const auto type = cursor_->type;
+        if (type == close && depth-- == 0) {
+            return true;
         }
+        depth += type == open;
+        cursor_.next();
+        ++stats_.tokens_skipped;
     }
     return false;
 }
 
+/**
+ * Moves the cursor to a marked position, reading a streamed program's
+ * window again if it has been replaced.
+ *
+ * @param mark The position
+ */
+void SUBARUU::restore(const Tokenizer::Mark& mark) {
+    if (tokenizer_->streaming()) {
+        tokenizer_->restore(mark);
+        cursor_ = tokenizer_->cursor();
+    } else {
+        cursor_.seek(mark.token);
+    }
+}
+
+/**
+ * Jumps to a line: a single seek to the token its entry in the line table
+ * holds. A line a lazily loaded program has not reached yet is read on
+ * for first, and a streamed program finds its lines as it goes.
+ *
+ * @param line_number The line to jump to
+ * @param target Index of the jump's line number token, for the error
+ */
+void SUBARUU::jump_to_line(int line_number, std::size_t target) {
+    if (tokenizer_->streaming()) {
+        stream_jump(line_number, target);
+        return;
+    }
+    std::uint32_t entry = line_table_.lookup(line_number);
+    if (entry == LineTable::NONE && discover(line_number)) {
+        entry = line_table_.lookup(line_number);
+    }
+    if (entry == LineTable::NONE) {
+        dprintf("Runtime Error: Line number " + std::to_string(line_number) +
+                  " not found",
+                E_ERROR,
+                tokenizer_->location(target));
+        return;
+    }
+    jump_to(line_table_[entry].token);
+}
+
+/**
+ * Jumps to a line whose number token is known.
+ *
+ * @param address Index of the line number token
+ */
+void SUBARUU::jump_to(std::uint32_t address) {
+    if (failed()) {
+        return;
+    }
+    jumped();
+    cursor_.seek(address);
+    TRACE_LOG(JUMPS, "Jumped to line " << cursor_->value);
+    enter_line(cursor_->value);
+    cursor_.next(); // Skip past the line number
+}
+
 /**
  * Executes a PRINT statement.
  * Format: PRINT [expression|string|separator]...
  */
 void SUBARUU::print_statement() {
-    DEBUG_LOG("Entering print_statement");
+    TRACE_LOG(OUTPUT, "Entering print_statement");
     accept(Tokenizer::TokenType::PRINT);
     bool need_space = false;
-    while (!tokenizer_->finished()) {
-        auto token = tokenizer_->current_token();
-        DEBUG_LOG("Print token: " << get_token_string(token));
+    while (!cursor_.at_end()) {
+        auto token = cursor_->type;
+        TRACE_LOG(OUTPUT, "Print token: " << get_token_string(token));
         // Check for statement end
         if (is_statement_end(token)) {
             break;
@@ -514,46 +1194,89 @@ void SUBARUU::print_statement() {
         switch (token) {
             case Tokenizer::TokenType::STRING:
                 if (need_space) {
-                    std::cout << " ";
+                    write_output(" ");
                 }
-                std::cout << tokenizer_->get_string();
+                write_output(tokenizer_->literal(cursor_->value));
                 need_space = true;
-                tokenizer_->next_token();
+                cursor_.next();
                 break;
             case Tokenizer::TokenType::SEPARATOR:
                 need_space = false; // Reset need_space since we're using comma
-                std::cout << " ";   // Single space after the previous item
-                tokenizer_->next_token();
+                write_output(" ");  // Single space after the previous item
+                cursor_.next();
                 break;
             case Tokenizer::TokenType::LETTER:
             case Tokenizer::TokenType::NUMBER:
-            case Tokenizer::TokenType::LEFT_PAREN:
+            case Tokenizer::TokenType::LEFT_PAREN: {
+                const int value = expression();
+                if (failed()) {
+                    return;
+                }
                 if (need_space) {
-                    std::cout << " ";
+                    write_output(" ");
                 }
-                std::cout << expression();
+                write_output(value);
                 need_space = true;
                 break;
+            }
             default:
-                DEBUG_LOG(
+                TRACE_LOG(OUTPUT, 
                   "Found unexpected token: " << get_token_string(token));
                 goto end_print;
         }
     }
 end_print:
-    std::cout << std::endl;
-    auto final_token = tokenizer_->current_token();
-    DEBUG_LOG("End of print, final token: " << get_token_string(final_token));
+    end_output_line();
+    auto final_token = cursor_->type;
+    TRACE_LOG(OUTPUT,
+              "End of print, final token: " << get_token_string(final_token));
     if (is_line_number()) {
-        DEBUG_LOG("Stopping at line number: " << tokenizer_->get_num());
+        TRACE_LOG(OUTPUT, "Stopping at line number: " << cursor_->value);
         return;
     }
     // Handle normal statement endings
     if (final_token == Tokenizer::TokenType::EOF_TOKEN) {
         execution_finished_ = true;
-    } else if (final_token == Tokenizer::TokenType::EOL) {
-        tokenizer_->next_token();
+    } else if (final_token == Tokenizer::TokenType::EOL ||
+               final_token == Tokenizer::TokenType::COLON) {
+        cursor_.next();
+    }
+}
+
+/**
+ * Writes PRINT output, counting the bytes.
+ *
+ * @param text The text to write
+ */
+void SUBARUU::write_output(std::string_view text) {
+    std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+    stats_.output_bytes += text.size();
+}
+
+/**
+ * Writes a number as PRINT output, counting the bytes.
+ *
+ * @param value The number to write
+ */
+void SUBARUU::write_output(int value) {
+    char digits[16];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    write_output(std::string_view(digits, result.ptr - digits));
+}
+
+/**
+ * Ends a line of PRINT output and flushes it, as every PRINT does.
+ */
+void SUBARUU::end_output_line() {
+    if (tracer_ && tracer_->sample_flush()) [[unlikely]] {
+        Tracer::Span span(tracer_.get(), "flush", "output");
+        std::cout << std::endl;
+    } else {
+        std::cout << std::endl;
     }
+    ++stats_.output_bytes;
+    ++stats_.output_flushes;
+    TRACE_LOG(OUTPUT, "Flushed, " << stats_.output_bytes << " bytes so far");
 }
 
 /**
@@ -561,60 +1284,105 @@ end_print:
  */
 bool SUBARUU::is_statement_end(Tokenizer::TokenType token) const {
     return token == Tokenizer::TokenType::EOL ||
+           token == Tokenizer::TokenType::COLON ||
            token == Tokenizer::TokenType::EOF_TOKEN;
 }
 
 /**
- * Checks if current token is a valid line number
+ * Checks if current token is the line number that starts a line
  */
 bool SUBARUU::is_line_number() const {
-    if (tokenizer_->current_token() != Tokenizer::TokenType::NUMBER) {
-        return false;
-    }
-    int num = tokenizer_->get_num();
-    if (num >= 10 && num % 10 == 0) {
-        char next_char = tokenizer_->peek_char();
-        return (next_char == ' ' || next_char == '\n' || next_char == '\r');
-    }
-    return false;
+    return cursor_->type == Tokenizer::TokenType::NUMBER &&
+           (cursor_->flags & Tokenizer::LINE_START);
 }
 
 /**
  * Executes a statement based on the current token.
- * Handles REM, PRINT, IF, GOTO, and LET statements.
- *
- * @throws std::runtime_error on syntax errors
+ * Handles REM, PRINT, IF, GOTO, ON, GOSUB, RETURN, FOR, NEXT, WHILE, WEND,
+ * DIM and LET statements. A statement ends at the end of its line or at a ':'
+ * before another statement on the same line; a REM runs to the end of its
+ * line, ':'s and all.
  */
 void SUBARUU::statement() {
-    auto token = tokenizer_->current_token();
-    DEBUG_LOG("Processing statement with token: " << get_token_string(token));
+    auto token = cursor_->type;
+    TRACE_LOG(PARSER,
+              "Processing statement with token: " << get_token_string(token));
     switch (token) {
         case Tokenizer::TokenType::REM:
-            DEBUG_LOG("Found REM statement");
-            tokenizer_->skip_to_eol();
+            TRACE_LOG(PARSER, "Found REM statement");
+            ++stats_.statements[Stats::REM];
+            while (!cursor_.at_end() &&
+                   cursor_->type != Tokenizer::TokenType::EOL) {
+                cursor_.advance();
+            }
+            cursor_.next();
             break;
         case Tokenizer::TokenType::PRINT:
-            DEBUG_LOG("Found PRINT statement");
+            TRACE_LOG(PARSER, "Found PRINT statement");
+            ++stats_.statements[Stats::PRINT];
             print_statement();
             break;
         case Tokenizer::TokenType::IF:
-            DEBUG_LOG("Found IF statement");
+            TRACE_LOG(PARSER, "Found IF statement");
+            ++stats_.statements[Stats::IF];
             if_statement();
             break;
         case Tokenizer::TokenType::GOTO:
-            DEBUG_LOG("Found GOTO statement");
+            TRACE_LOG(PARSER, "Found GOTO statement");
+            ++stats_.statements[Stats::GOTO];
             goto_statement();
             break;
+        case Tokenizer::TokenType::ON:
+            TRACE_LOG(PARSER, "Found ON statement");
+            ++stats_.statements[Stats::ON];
+            on_statement();
+            break;
+        case Tokenizer::TokenType::GOSUB:
+            TRACE_LOG(PARSER, "Found GOSUB statement");
+            ++stats_.statements[Stats::GOSUB];
+            gosub_statement();
+            break;
+        case Tokenizer::TokenType::RETURN:
+            TRACE_LOG(PARSER, "Found RETURN statement");
+            ++stats_.statements[Stats::RETURN];
+            return_statement();
+            break;
+        case Tokenizer::TokenType::FOR:
+            TRACE_LOG(PARSER, "Found FOR statement");
+            ++stats_.statements[Stats::FOR];
+            for_statement();
+            break;
+        case Tokenizer::TokenType::NEXT:
+            TRACE_LOG(PARSER, "Found NEXT statement");
+            ++stats_.statements[Stats::NEXT];
+            next_statement();
+            break;
+        case Tokenizer::TokenType::WHILE:
+            TRACE_LOG(PARSER, "Found WHILE statement");
+            ++stats_.statements[Stats::WHILE];
+            while_statement();
+            break;
+        case Tokenizer::TokenType::WEND:
+            TRACE_LOG(PARSER, "Found WEND statement");
+            ++stats_.statements[Stats::WEND];
+            wend_statement();
+            break;
+        case Tokenizer::TokenType::DIM:
+            TRACE_LOG(PARSER, "Found DIM statement");
+            ++stats_.statements[Stats::DIM];
+            dim_statement();
+            break;
         case Tokenizer::TokenType::LET:
-            DEBUG_LOG("Found LET statement");
+            TRACE_LOG(PARSER, "Found LET statement");
             accept(Tokenizer::TokenType::LET);
             [[fallthrough]];
         case Tokenizer::TokenType::LETTER:
-            DEBUG_LOG("Found assignment statement");
+            TRACE_LOG(PARSER, "Found assignment statement");
+            ++stats_.statements[Stats::LET];
             let_statement();
             break;
         default:
-            DEBUG_LOG(
+            TRACE_LOG(PARSER, 
               "Unrecognized statement type: " << get_token_string(token));
             dprintf("Syntax Error: Unrecognized statement", E_ERROR);
             break;
@@ -623,145 +1391,261 @@ void SUBARUU::statement() {
 
 /**
  * Parses and executes a line statement.
- * Handles line numbers and statement execution.
+ * Handles line numbers and statement execution. Each call runs one
+ * statement, so a line of several separated by ':' takes several calls,
+ * but enters its line and is found by a jump only once.
  */
 
 void SUBARUU::line_statement() {
-    DEBUG_LOG("Starting line_statement");
-    // Skip empty lines
-    while (tokenizer_->current_token() == Tokenizer::TokenType::EOL) {
-        tokenizer_->next_token();
+    TRACE_LOG(PARSER, "Starting line_statement");
+    // Skip empty lines, and the ':' left after a statement that does not
+    // read its own end, or before an empty one
+    while (cursor_->type == Tokenizer::TokenType::EOL ||
+           cursor_->type == Tokenizer::TokenType::COLON) {
+        cursor_.next();
     }
-    // Check for end of file
-    if (tokenizer_->current_token() == Tokenizer::TokenType::EOF_TOKEN) {
-        execution_finished_ = true;
+    // Check for end of file, or of a streamed window
+    if (cursor_->type == Tokenizer::TokenType::EOF_TOKEN) {
+        execution_finished_ = !next_window();
         return;
     }
 
-    if (tokenizer_->current_token() == Tokenizer::TokenType::NUMBER) {
-        tokenizer_->next_token(); // Move past line number
+    if (is_line_number()) {
+        enter_line(cursor_->value);
+        cursor_.next(); // Move past line number
     }
 
     statement();
 }
 
 /**
- * Builds a map of line numbers in the program.
- * Maps each line number to its position in the source.
+ * Builds the line table from the numbered lines the tokenizer noted while
+ * lexing, so no pass over the tokens is needed.
  */
 void SUBARUU::build_line_map() {
-    DEBUG_LOG("Building line number map");
-    line_positions_.clear();
-    tokenizer_->reset();
-    std::unordered_map<int, bool> found_lines;
-    // Scan through tokens looking for line numbers
-    while (!tokenizer_->finished()) {
-        auto token = tokenizer_->current_token();
-        DEBUG_LOG("Map building - current token: " << get_token_string(token));
-
-        if (token == Tokenizer::TokenType::NUMBER) {
-            int value = tokenizer_->get_num();
-            if (is_valid_line_number(value)) {
-                line_positions_[value] = true;
-                found_lines[value] = true;
-                DEBUG_LOG("Found line number: " << value);
-            }
-        }
-        tokenizer_->next_token();
+    Tracer::Span span(tracer_.get(), "build_line_map", "load");
+    TRACE_LOG(JUMPS, "Building line number map");
+    line_table_.clear();
+    lines_mapped_ = 0;
+    rewind();
+    map_lines();
+    if (trace_enabled(TraceCategory::JUMPS)) {
+        log_found_line_numbers(line_table_);
+    }
+    if (profiler_) {
+        profiler_->seed(line_table_.numbers());
     }
-#ifdef DEBUG_MODE
-    log_found_line_numbers(found_lines);
-#endif
-    tokenizer_->reset();
+    if (perf_counters_) {
+        perf_counters_->seed(line_table_.numbers());
+    }
+    rewind();
 }
 
-#ifdef DEBUG_MODE
 /**
- * Helper to log all found line numbers during map building
+ * Adds the numbered lines lexed since the last call to the line table.
  */
-void SUBARUU::log_found_line_numbers(
-  const std::unordered_map<int, bool>& found_lines) {
-    std::string line_numbers;
-    for (const auto& [line, _] : found_lines) {
-        if (!line_numbers.empty()) {
-            line_numbers += " ";
+void SUBARUU::map_lines() {
+    const auto& lines = tokenizer_->lines();
+    for (; lines_mapped_ < lines.size(); ++lines_mapped_) {
+        line_table_.add(lines[lines_mapped_].line,
+                        lines[lines_mapped_].token);
+        TRACE_LOG(JUMPS, "Found line number: " << lines[lines_mapped_].line);
+    }
+    line_table_.index();
+}
+
+/**
+ * Resolves the line number after every THEN, GOTO and GOSUB, and the list
+ * after the GOTO of an ON statement, to the index of the target's line
+ * number token, so a taken jump is a single seek. A GOTO or GOSUB
+ * followed by anything but a single number computes its target as it
+ * runs. Each FOR and WHILE is linked to the NEXT or WEND that closes it,
+ * and each WEND back to its WHILE. Every target that does not exist is
+ * reported, and the first fails the program.
+ */
+void SUBARUU::link() {
+    Tracer::Span span(tracer_.get(), "link", "load");
+    const auto& tokens = tokenizer_->tokens();
+    bool on = false; // In an ON statement
+    std::vector<std::size_t> loops;  // FORs not closed yet
+    std::vector<std::size_t> whiles; // Likewise WHILEs
+    for (std::size_t i = 0; i + 1 < tokens.size(); ++i) {
+        const auto type = tokens[i].type;
+        if (type == Tokenizer::TokenType::FOR) {
+            loops.push_back(i);
+        } else if (type == Tokenizer::TokenType::NEXT && !loops.empty()) {
+            link_loop(loops.back(), i);
+            loops.pop_back();
+        } else if (type == Tokenizer::TokenType::WHILE) {
+            whiles.push_back(i);
+        } else if (type == Tokenizer::TokenType::WEND && !whiles.empty()) {
+            link_loop(whiles.back(), i);
+            whiles.pop_back();
+        } else if (type == Tokenizer::TokenType::ON) {
+            on = true;
+        } else if (is_statement_end(type)) {
+            on = false;
+        } else if (type == Tokenizer::TokenType::GOTO && on) {
+            link_list(i);
+        } else if ((type == Tokenizer::TokenType::THEN ||
+                    type == Tokenizer::TokenType::GOTO ||
+                    type == Tokenizer::TokenType::GOSUB) &&
+                   tokens[i + 1].type == Tokenizer::TokenType::NUMBER &&
+                   is_statement_end(tokens[i + 2].type)) {
+            link_target(i + 1);
         }
-        line_numbers += std::to_string(line);
     }
-    DEBUG_LOG("Found these line numbers: " << line_numbers);
+    if (failed()) {
+        execution_finished_ = true;
+        cursor_.seek(cursor_.size());
+    }
 }
-#endif
+
 /**
- * Finds a specific line number in the source code.
- * Builds line map if not already built.
+ * Links a FOR or WHILE to the end of the NEXT or WEND that closes it in
+ * the program text, where the program goes on once the loop is done, and
+ * a WEND back to where its WHILE's line starts. A NEXT that names another
+ * variable is left for the loop to find as it runs.
  *
- * @param linenum The line number to find
- * @throws std::runtime_error if line number not found
+ * @param loop Index of the FOR or WHILE token
+ * @param close Index of the NEXT or WEND token
  */
+void SUBARUU::link_loop(std::size_t loop, std::size_t close) {
+    const auto& tokens = tokenizer_->tokens();
+    std::size_t end = close + 1;
+    if (tokens[loop].type == Tokenizer::TokenType::FOR &&
+        tokens[end].type == Tokenizer::TokenType::LETTER) {
+        if (tokens[loop + 1].type != Tokenizer::TokenType::LETTER ||
+            tokens[loop + 1].value != tokens[end].value) {
+            return;
+        }
+        ++end;
+    }
+    if (!is_statement_end(tokens[end].type)) {
+        return;
+    }
+    tokenizer_->link(loop, static_cast<std::uint32_t>(end));
+    if (tokens[loop].type == Tokenizer::TokenType::WHILE) {
+        tokenizer_->link(close, static_cast<std::uint32_t>(while_head(loop)));
+    }
+}
 
-void SUBARUU::find_linenum(int linenum) {
-    DEBUG_LOG("Searching for line number: " << linenum);
+/**
+ * Finds where a WEND goes back to: the number of the WHILE's line when
+ * the line starts with it, so the line is entered again, or else the
+ * WHILE itself.
+ *
+ * @param loop Index of the WHILE token
+ * @return Index of the token to go back to
+ */
+std::size_t SUBARUU::while_head(std::size_t loop) const {
+    const auto& tokens = tokenizer_->tokens();
+    const bool numbered =
+      loop > 0 && tokens[loop - 1].type == Tokenizer::TokenType::NUMBER &&
+      (tokens[loop - 1].flags & Tokenizer::LINE_START);
+    return numbered ? loop - 1 : loop;
+}
 
-    // Build line map if needed
-    if (line_positions_.empty()) {
-        build_line_map();
+/**
+ * Links the list of line numbers after the GOTO of an ON statement, and
+ * gives the GOTO their count so the one chosen is found without reading
+ * the others. A list that is not just numbers and commas is left to fail
+ * when it runs.
+ *
+ * @param go Index of the GOTO token
+ */
+void SUBARUU::link_list(std::size_t go) {
+    const auto& tokens = tokenizer_->tokens();
+    if (tokens[go].flags & Tokenizer::LINKED) {
+        return;
     }
-
-    // Check if line exists in map
-    if (line_positions_.find(linenum) == line_positions_.end()) {
-        std::string error = "Runtime Error: Line number " +
-                            std::to_string(linenum) + " not found";
-        dprintf(error, E_ERROR);
+    std::size_t last = go + 1;
+    while (tokens[last].type == Tokenizer::TokenType::NUMBER &&
+           tokens[last + 1].type == Tokenizer::TokenType::SEPARATOR) {
+        last += 2;
+    }
+    if (tokens[last].type != Tokenizer::TokenType::NUMBER ||
+        !is_statement_end(tokens[last + 1].type)) {
         return;
     }
-
-    // Set up skip mode
-    skip_to_line_ = true;
-    target_line_ = linenum;
+    bool linked = true;
+    for (std::size_t target = go + 1; target <= last; target += 2) {
+        linked = link_target(target) && linked;
+    }
+    if (linked) {
+        tokenizer_->link(go, static_cast<std::uint32_t>((last - go + 1) / 2));
+    }
 }
 
 /**
- * Jumps to a specific line number.
- * Sets up line search and initiates the search operation.
+ * Links one jump target, reporting it if its line does not exist.
  *
- * @param linenum The line number to jump to
+ * @param target Index of the target's NUMBER token
+ * @return false if the line does not exist
  */
-void SUBARUU::jump_linenum(int linenum) {
-    DEBUG_LOG("Attempting to jump to line " << linenum);
-    if (line_positions_.empty()) {
-        build_line_map();
+bool SUBARUU::link_target(std::size_t target) {
+    const Tokenizer::Token& token = tokenizer_->tokens()[target];
+    if (token.flags & Tokenizer::LINKED) {
+        return true;
     }
+    const std::uint32_t entry = line_table_.find(token.value);
+    if (entry == LineTable::NONE) {
+        const std::string error =
+          locate("Link Error: Line number " + std::to_string(token.value) +
+                   " not found",
+                 tokenizer_->location(target));
+        std::cerr << "ERROR: " << error << std::endl;
+        if (error_.empty()) {
+            error_ = error;
+        }
+        return false;
+    }
+    tokenizer_->link(target, line_table_[entry].token);
+    return true;
+}
 
-    // Reset tokenizer to start
-    tokenizer_->reset();
+/**
+ * Reads a lazily loaded program on until a line turns up, leaving the
+ * cursor where it was.
+ *
+ * @param line_number A line not in the line map
+ * @return true if the line was found; false at the end of the program,
+ *         or if the program is not loaded lazily
+ */
+bool SUBARUU::discover(int line_number) {
+    if (failed() || tokenizer_->loading() != Tokenizer::Loading::LAZY) {
+        return false;
+    }
+    TRACE_LOG(JUMPS, "Reading on for line " << line_number);
+    const std::size_t offset = cursor_.offset();
+    const bool found = tokenizer_->scan_to_line(line_number);
+    cursor_ = tokenizer_->begin();
+    cursor_.seek(offset);
+    map_lines();
+    return found;
+}
 
-    // Search for target line
-    while (!tokenizer_->finished()) {
-        auto token = tokenizer_->current_token();
-        if (token == Tokenizer::TokenType::NUMBER) {
-            int current_line = tokenizer_->get_num();
-            if (current_line == linenum) {
-                tokenizer_->next_token(); // Move past the line number
-                return;                   // Found our line, ready to execute
-            }
+/**
+ * Helper to log all found line numbers during map building
+ */
+void SUBARUU::log_found_line_numbers(const LineTable& found_lines) {
+    std::string line_numbers;
+    for (int line : found_lines.numbers()) {
+        if (!line_numbers.empty()) {
+            line_numbers += " ";
         }
-        tokenizer_->next_token();
+        line_numbers += std::to_string(line);
     }
-
-    // If we get here, line wasn't found
-    std::string error =
-      "Runtime Error: Line number " + std::to_string(linenum) + " not found";
-    dprintf(error, E_ERROR);
+    TRACE_LOG(JUMPS, "Found these line numbers: " << line_numbers);
 }
 
-#ifdef DEBUG_MODE
 /**
  * Helper to log available line numbers when target not found
  */
 void SUBARUU::log_available_lines(int target_line) {
-    DEBUG_LOG("Line " << target_line << " not found in map. Available lines:");
-    for (const auto& [line, _] : line_positions_) {
-        DEBUG_LOG(" " << line);
+    TRACE_LOG(JUMPS,
+              "Line " << target_line << " not found in map. Available lines:");
+    for (int line : line_table_.numbers()) {
+        TRACE_LOG(JUMPS, " " << line);
     }
 }
-#endif
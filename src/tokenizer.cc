@@ -1,32 +1,118 @@
 #include "../include/tokenizer.h"
 #include "../include/common.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <iostream>
+#include <stdexcept>
 #include <string_view>
+#include <system_error>
+#include <thread>
 
 /******************************************************************************/
 
+namespace {
+// Every keyword and the token it lexes to.
+constexpr Tokenizer::KeywordToken KEYWORDS[] = {
+    { "PRINT", Tokenizer::TokenType::PRINT },
+    { "LET", Tokenizer::TokenType::LET },
+    { "IF", Tokenizer::TokenType::IF },
+    { "THEN", Tokenizer::TokenType::THEN },
+    { "GOTO", Tokenizer::TokenType::GOTO },
+    { "ON", Tokenizer::TokenType::ON },
+    { "GOSUB", Tokenizer::TokenType::GOSUB },
+    { "RETURN", Tokenizer::TokenType::RETURN },
+    { "FOR", Tokenizer::TokenType::FOR },
+    { "TO", Tokenizer::TokenType::TO },
+    { "STEP", Tokenizer::TokenType::STEP },
+    { "NEXT", Tokenizer::TokenType::NEXT },
+    { "WHILE", Tokenizer::TokenType::WHILE },
+    { "WEND", Tokenizer::TokenType::WEND },
+    { "DIM", Tokenizer::TokenType::DIM },
+    { "REM", Tokenizer::TokenType::REM },
+};
+
+/**
+ * is_keyword
+ *
+ * @param word A word of the source, in any case
+ * @param keyword A keyword, in upper case
+ * @return Whether the word spells the keyword
+ */
+bool is_keyword(std::string_view word, std::string_view keyword) noexcept {
+    if (word.size() != keyword.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < word.size(); ++i) {
+        if (std::toupper(static_cast<unsigned char>(word[i])) != keyword[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
 /**
  * Tokenizer Constructor
  *
- * Constructs a new Tokenizer to process source text
+ * Constructs a new Tokenizer and lexes the whole source, or its first
+ * window when it is not loaded whole, into its token array
  *
  * @param source The input string to be tokenized
+ * @param loading Whether the source is loaded whole, lazily or streamed
+ * @param window The size of the windows a source that is not loaded whole
+ *        is read in, 0 for the default of its loading
+ * @param lex_chunk The size of the chunks a large loaded source is split
+ *        into to be lexed in parallel
+ * @param lex_threads The number of threads the chunks are lexed on, 0 for
+ *        one per core
  * @throws std::runtime_error if source file cannot be opened
  */
-Tokenizer::Tokenizer(std::string_view source)
-  : io_(std::make_unique<IO>(std::string(source)))
-  , current_token_(TokenType::ERROR)
-  , token_data_(std::monostate()) {
-    // Initialize keywords with their corresponding token types
-    keywords_ = { { "let", TokenType::LET },   { "if", TokenType::IF },
-                  { "then", TokenType::THEN }, { "print", TokenType::PRINT },
-                  { "rem", TokenType::REM },   { "goto", TokenType::GOTO } };
+Tokenizer::Tokenizer(std::string_view source,
+                     Loading loading,
+                     std::size_t window,
+                     std::size_t lex_chunk,
+                     unsigned lex_threads)
+  : io_(source, window_size(loading, window))
+  , loading_(loading)
+  , lex_chunk_(std::max<std::size_t>(1, lex_chunk))
+  , lex_threads_(lex_threads)
+  , resets_(0)
+  , tokens_lexed_(0)
+  , lines_before_(0)
+  , line_index_(nullptr)
+  , index_entries_(0)
+  , indexed_to_(0)
+  , index_last_(0)
+  , index_sorted_(true)
+  , index_writing_(true) {
+    if (io_.streaming()) {
+        io_.next_window();
+    }
+    lex();
+}
 
-    // Initialize the first token
-    current_token_ = get_next_token();
+/**
+ * window_size
+ *
+ * @param loading How the source is loaded
+ * @param window The window size asked for, 0 for the default
+ * @return The IO window size: 0 to load the source whole
+ */
+std::size_t Tokenizer::window_size(Loading loading, std::size_t window) {
+    switch (loading) {
+        case Loading::LAZY:
+            return window ? window : SUBARUU_LAZY_WINDOW;
+        case Loading::STREAM:
+            return window ? window : SUBARUU_STREAM_WINDOW;
+        default:
+            return 0;
+    }
 }
 
 /**
@@ -36,58 +122,573 @@ Tokenizer::Tokenizer(std::string_view source)
  * Ensures IO stream is properly closed if it exists
  */
 Tokenizer::~Tokenizer() {
-    if (io_) {
-        io_->close();
+    io_.close();
+    if (line_index_) {
+        std::fclose(line_index_);
     }
 }
 
 /**
- * reset
+ * lex
  *
- * Resets the tokenizer to initial state
- * - Resets IO stream to beginning
- * - Clears token data
- * - Gets first token from input
+ * Lexes the source, or the current window of it, from start to end into
+ * the token array, which always ends with an EOF_TOKEN
  *
  * @param void
  * @return void
  */
-void Tokenizer::reset() {
-    DEBUG_LOG("Resetting tokenizer");
-    io_->reset();
-    token_data_ = std::monostate();
-    current_token_ = get_next_token();
+void Tokenizer::lex() {
+    tokens_lexed_ += tokens_.size();
+    if (io_.streaming() || !lex_parallel()) {
+        lex_serial();
+    }
+    cursor_ = Cursor<Token>(tokens_.data(), &tokens_.back());
+    if (streaming()) {
+        index_lines();
+    }
 }
 
 /**
- * reset
+ * lex_serial
+ *
+ * @param void
+ * @return void
+ */
+void Tokenizer::lex_serial() {
+    Lexer lexer(io_.data(), io_.data() + io_.size());
+    lexer.lex();
+    adopt(lexer);
+}
+
+/**
+ * adopt
  *
- * Sets current token to specified type without reading input
+ * Takes over a lexer's arrays as the tokenizer's own
  *
- * @param to The TokenType to set as current
+ * @param lexer A lexer that has lexed the whole source
  * @return void
  */
-void Tokenizer::reset(TokenType to) { current_token_ = to; }
+void Tokenizer::adopt(Lexer& lexer) {
+    tokens_ = std::move(lexer.tokens_);
+    literal_pool_ = std::move(lexer.literal_pool_);
+    literal_ends_ = std::move(lexer.literal_ends_);
+    columns_ = std::move(lexer.columns_);
+    line_tokens_ = std::move(lexer.line_tokens_);
+    lines_ = std::move(lexer.lines_);
+}
 
 /**
- * peek_char
+ * lex_parallel
  *
- * Looks at next character in input without advancing position
+ * Splits a loaded source into chunks of about lex_chunk_ bytes, each
+ * ending at a newline, lexes them on a pool of lex_threads_ threads, or
+ * one per core, and stitches the results together. Each chunk is lexed
+ * from a copy of its own that ends in a '\0', as the lexer expects, and a
+ * chunk starts a line just as the whole source does, so the stitched
+ * arrays are the serial ones. The one exception is a token that runs on
+ * past the newline a chunk ends at, which only an unterminated string can;
+ * the source is then lexed serially instead.
  *
  * @param void
- * @return Next character in input stream
+ * @return false if the source is too small to split or there is only one
+ *         thread to lex it on, or if it has to be lexed serially after all
+ */
+bool Tokenizer::lex_parallel() {
+    const char* const source = io_.data();
+    const std::size_t size = io_.size();
+    if (size / lex_chunk_ < 2) {
+        return false;
+    }
+    // Asking for the core count reads /sys, which would cost a small
+    // program more than lexing it, so it is asked once and only here
+    static const unsigned cores = std::thread::hardware_concurrency();
+    const unsigned threads = lex_threads_ ? lex_threads_ : cores;
+    if (threads < 2) {
+        return false;
+    }
+    std::vector<std::size_t> bounds{ 0 };
+    while (bounds.back() + lex_chunk_ < size) {
+        const void* newline = std::memchr(source + bounds.back() + lex_chunk_,
+                                          '\n',
+                                          size - bounds.back() - lex_chunk_);
+        if (!newline) {
+            break;
+        }
+        bounds.push_back(
+          static_cast<const char*>(newline) - source + std::size_t{ 1 });
+    }
+    if (bounds.back() != size) {
+        bounds.push_back(size);
+    }
+    const std::size_t chunks = bounds.size() - 1;
+    if (chunks < 2) {
+        return false;
+    }
+
+    std::vector<Lexer> lexers(chunks, Lexer(nullptr, nullptr));
+    // Workers take the next chunk until none are left
+    std::atomic<std::size_t> next{ 0 };
+    std::exception_ptr failure;
+    std::atomic<bool> failed{ false };
+    const auto work = [&]() {
+        try {
+            for (std::size_t i = next++; i < chunks; i = next++) {
+                const std::string text(source + bounds[i],
+                                       source + bounds[i + 1]);
+                lexers[i] = Lexer(text.data(), text.data() + text.size());
+                lexers[i].lex();
+            }
+        } catch (...) {
+            if (!failed.exchange(true)) {
+                failure = std::current_exception();
+            }
+        }
+    };
+    const std::size_t workers = std::min<std::size_t>(chunks, threads);
+    std::vector<std::thread> pool;
+    for (std::size_t i = 1; i < workers; ++i) {
+        try {
+            pool.emplace_back(work);
+        } catch (const std::system_error&) {
+            break; // The threads already started take the rest
+        }
+    }
+    work();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+
+    // Every chunk but the last must end with the EOL of its last newline
+    std::size_t tokens = 0;
+    std::size_t literals = 0;
+    std::size_t lines = 0;
+    for (std::size_t i = 0; i < chunks; ++i) {
+        const auto& chunk = lexers[i].tokens_;
+        const bool clean =
+          chunk.size() >= 2 && chunk[chunk.size() - 2].type == TokenType::EOL;
+        if (i + 1 < chunks && !clean) {
+            return false;
+        }
+        tokens += chunk.size();
+        literals += lexers[i].literal_pool_.size();
+        lines += lexers[i].lines_.size();
+    }
+
+    tokens_.clear();
+    literal_pool_.clear();
+    literal_ends_.clear();
+    columns_.clear();
+    line_tokens_.clear();
+    lines_.clear();
+    tokens_.reserve(tokens);
+    columns_.reserve(tokens);
+    literal_pool_.reserve(literals);
+    lines_.reserve(lines);
+    for (std::size_t i = 0; i < chunks; ++i) {
+        append(lexers[i], bounds[i]);
+        lexers[i] = Lexer(nullptr, nullptr);
+    }
+    return true;
+}
+
+/**
+ * append
+ *
+ * Adds a lexer's arrays to the end of the tokenizer's, in place of the
+ * EOF_TOKEN that ends them, rebasing literal and token indices. The run it
+ * lexed must follow on from the last newline lexed before.
+ *
+ * @param lexer A lexer that has lexed the run
+ * @param offset Where the run starts in the source
+ * @return void
+ */
+void Tokenizer::append(Lexer& lexer, std::uint64_t offset) {
+    // The run's first line is the line the EOF_TOKEN started
+    std::size_t first_line = 0;
+    if (!tokens_.empty()) {
+        tokens_.pop_back();
+        columns_.pop_back();
+        first_line = 1;
+    }
+    const auto token_base = static_cast<std::uint32_t>(tokens_.size());
+    const auto literal_base = static_cast<std::int32_t>(literal_ends_.size());
+    const auto pool_base = static_cast<std::uint32_t>(literal_pool_.size());
+    for (Token token : lexer.tokens_) {
+        if (token.type == TokenType::STRING) {
+            token.value += literal_base;
+        }
+        tokens_.push_back(token);
+    }
+    columns_.insert(
+      columns_.end(), lexer.columns_.begin(), lexer.columns_.end());
+    literal_pool_ += lexer.literal_pool_;
+    for (const std::uint32_t end : lexer.literal_ends_) {
+        literal_ends_.push_back(pool_base + end);
+    }
+    for (std::size_t l = first_line; l < lexer.line_tokens_.size(); ++l) {
+        line_tokens_.push_back(token_base + lexer.line_tokens_[l]);
+    }
+    for (NumberedLine line : lexer.lines_) {
+        line.token += token_base;
+        line.offset += offset;
+        lines_.push_back(line);
+    }
+}
+
+/**
+ * Lexer Constructor
+ *
+ * @param begin The first character of a run of whole lines
+ * @param end Just past the last one, where a '\0' must be
+ */
+Tokenizer::Lexer::Lexer(const char* begin, const char* end)
+  : source_(begin, end)
+  , line_begin_(0) {}
+
+/**
+ * Lexer::lex
+ *
+ * Lexes the run from start to end into the token array, which always ends
+ * with an EOF_TOKEN, and notes its numbered lines
+ *
+ * @param void
+ * @return void
+ */
+void Tokenizer::Lexer::lex() {
+    // Most tokens take four to eight characters of source.
+    tokens_.reserve(source_.size() / 4 + 1);
+    columns_.reserve(tokens_.capacity());
+    line_tokens_.push_back(0);
+    bool line_start = true;
+    while (true) {
+        Token token = get_next_token();
+        if (line_start) {
+            token.flags |= LINE_START;
+            if (token.type == TokenType::NUMBER) {
+                lines_.push_back(
+                  { token.value,
+                    static_cast<std::uint32_t>(tokens_.size()),
+                    line_begin_ });
+            }
+        }
+        line_start = token.type == TokenType::EOL;
+        tokens_.push_back(token);
+        if (line_start) {
+            line_tokens_.push_back(static_cast<std::uint32_t>(tokens_.size()));
+        }
+        if (token.type == TokenType::EOF_TOKEN) {
+            break;
+        }
+    }
+}
+
+/**
+ * next_window
+ *
+ * Replaces the token array with the next window of a streamed source, or
+ * appends the next window of a lazily loaded one to it. Either way the
+ * cursor moves to the window's first token.
+ *
+ * @param void
+ * @return false if the source is loaded whole or has no more windows, in
+ *         which case the tokens are left as they are
+ * @throws std::runtime_error If the source cannot be read
+ */
+bool Tokenizer::next_window() {
+    if (!io_.streaming() || !io_.next_window()) {
+        return false;
+    }
+    if (streaming()) {
+        lines_before_ += static_cast<std::uint32_t>(line_tokens_.size() - 1);
+        lex();
+        return true;
+    }
+    Lexer lexer(io_.data(), io_.data() + io_.size());
+    lexer.lex();
+    const std::size_t first = tokens_.size() - 1;
+    append(lexer, io_.window_offset());
+    cursor_ = begin();
+    cursor_.seek(first);
+    return true;
+}
+
+/**
+ * seek_window
+ *
+ * Lexes a streamed source again from the start of a line
+ *
+ * @param offset File offset of the line
+ * @param lines_before Source lines before it
+ * @return void
+ * @throws std::runtime_error If the source cannot be read
+ */
+void Tokenizer::seek_window(std::uint64_t offset, std::uint32_t lines_before) {
+    io_.seek_window(offset);
+    lines_before_ = lines_before;
+    lex();
+}
+
+/**
+ * index_lines
+ *
+ * Appends the numbered lines of the window just lexed to the line index,
+ * but for those indexed when lexed before
+ *
+ * @param void
+ * @return void
+ * @throws std::runtime_error If the index cannot be written
+ */
+void Tokenizer::index_lines() {
+    const std::uint64_t window_end = io_.window_offset() + io_.size();
+    if (window_end <= indexed_to_) {
+        return;
+    }
+    for (const NumberedLine& numbered : lines_) {
+        const std::uint64_t offset = io_.window_offset() + numbered.offset;
+        if (offset < indexed_to_) {
+            continue;
+        }
+        if (!line_index_) {
+            line_index_ = std::tmpfile();
+            if (!line_index_) {
+                throw std::runtime_error("Failed to create line index");
+            }
+        }
+        if (!index_writing_) {
+            std::fseek(line_index_, 0, SEEK_END);
+            index_writing_ = true;
+        }
+        const IndexEntry entry{ numbered.line,
+                                location(numbered.token).line,
+                                offset };
+        if (std::fwrite(&entry, sizeof(entry), 1, line_index_) != 1) {
+            throw std::runtime_error("Failed to write line index");
+        }
+        index_sorted_ = index_sorted_ &&
+                        (index_entries_ == 0 || numbered.line > index_last_);
+        index_last_ = numbered.line;
+        ++index_entries_;
+    }
+    indexed_to_ = window_end;
+}
+
+/**
+ * find_in_window
+ *
+ * @param line A line number
+ * @return true, with the cursor on the line's number, if the line is in
+ *         the current window
+ */
+bool Tokenizer::find_in_window(int line) {
+    auto found = lines_.end();
+    if (index_sorted_) {
+        found = std::lower_bound(
+          lines_.begin(),
+          lines_.end(),
+          line,
+          [](const NumberedLine& entry, int value) {
+              return entry.line < value;
+          });
+    } else {
+        found = std::find_if(
+          lines_.begin(),
+          lines_.end(),
+          [line](const NumberedLine& entry) { return entry.line == line; });
+    }
+    if (found == lines_.end() || found->line != line) {
+        return false;
+    }
+    cursor_.seek(found->token);
+    return true;
+}
+
+/**
+ * find_line
+ *
+ * Looks a line up in the current window and then in the line index. The
+ * index is searched in place on disk: a binary search while the line
+ * numbers go up, as they do in nearly every program, a scan for the first
+ * of them otherwise.
+ *
+ * @param line A line number
+ * @return true, with the cursor on the line's number, if the line has
+ *         been lexed before
+ * @throws std::runtime_error If the index or the source cannot be read
  */
-char Tokenizer::peek_char() { return io_->peek(); }
+bool Tokenizer::find_line(int line) {
+    if (index_sorted_ && find_in_window(line)) {
+        return true;
+    }
+    if (!line_index_) {
+        return false;
+    }
+    std::fflush(line_index_);
+    index_writing_ = false;
+    IndexEntry entry{};
+    const auto read = [this, &entry](std::uint64_t i) {
+        std::fseek(
+          line_index_, static_cast<long>(i * sizeof(IndexEntry)), SEEK_SET);
+        if (std::fread(&entry, sizeof(entry), 1, line_index_) != 1) {
+            throw std::runtime_error("Failed to read line index");
+        }
+    };
+    bool found = false;
+    if (index_sorted_) {
+        std::uint64_t low = 0;
+        std::uint64_t high = index_entries_;
+        while (low < high && !found) {
+            const std::uint64_t mid = low + (high - low) / 2;
+            read(mid);
+            found = entry.line == line;
+            if (entry.line < line) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+    } else {
+        for (std::uint64_t i = 0; i < index_entries_ && !found; ++i) {
+            read(i);
+            found = entry.line == line;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+    if (entry.offset >= io_.window_offset() &&
+        entry.offset < io_.window_offset() + io_.size()) {
+        return find_in_window(line);
+    }
+    seek_window(entry.offset, entry.source_line - 1);
+    return true;
+}
+
+/**
+ * scan_to_line
+ *
+ * Lexes one window after another until one holds the line. Meant for a
+ * line that has not been found in what was lexed so far, so only the
+ * windows read from here on are searched.
+ *
+ * @param line A line number
+ * @return true, with the cursor on the line's number, if the line was
+ *         found; false at the end of the source
+ * @throws std::runtime_error If the source cannot be read
+ */
+bool Tokenizer::scan_to_line(int line) {
+    while (true) {
+        const std::size_t lexed = lines_.size();
+        if (!next_window()) {
+            return false;
+        }
+        if (streaming() ? find_in_window(line) : find_in(lexed, line)) {
+            return true;
+        }
+    }
+}
+
+/**
+ * mark
+ *
+ * A streamed position is kept relative to the numbered line it is on,
+ * which starts a window when its own is read again.
+ *
+ * @param token Index of a token in the current window
+ * @return A mark that restore() takes back to it
+ */
+Tokenizer::Mark Tokenizer::mark(std::size_t token) const {
+    const auto index = static_cast<std::uint32_t>(token);
+    if (!streaming()) {
+        return { 0, 0, index };
+    }
+    const auto after = std::upper_bound(
+      lines_.begin(),
+      lines_.end(),
+      index,
+      [](std::uint32_t value, const NumberedLine& numbered) {
+          return value < numbered.token;
+      });
+    if (after == lines_.begin()) {
+        return { io_.window_offset(), lines_before_, index };
+    }
+    const NumberedLine& numbered = *(after - 1);
+    return { io_.window_offset() + numbered.offset,
+             location(numbered.token).line - 1,
+             index - numbered.token };
+}
+
+/**
+ * restore
+ *
+ * @param mark Where mark() was called
+ * @return void
+ * @throws std::runtime_error If the source cannot be read again
+ */
+void Tokenizer::restore(const Mark& mark) {
+    if (!streaming()) {
+        cursor_.seek(mark.token);
+        return;
+    }
+    const std::uint64_t window = io_.window_offset();
+    if (mark.offset >= window && mark.offset < window + io_.size()) {
+        const std::uint64_t offset = mark.offset - window;
+        const auto found = std::lower_bound(
+          lines_.begin(),
+          lines_.end(),
+          offset,
+          [](const NumberedLine& numbered, std::uint64_t value) {
+              return numbered.offset < value;
+          });
+        if (found != lines_.end() && found->offset == offset) {
+            cursor_.seek(found->token + mark.token);
+            return;
+        }
+    }
+    if (mark.offset != window) {
+        seek_window(mark.offset, mark.source_line);
+    }
+    cursor_.seek(std::min<std::size_t>(mark.token, tokens_.size() - 1));
+}
+
+/**
+ * find_in
+ *
+ * @param first The first of the numbered lines to look at
+ * @param line A line number
+ * @return true, with the cursor on the line's number, if the line is one
+ *         of the numbered lines from first on
+ */
+bool Tokenizer::find_in(std::size_t first, int line) {
+    for (std::size_t i = first; i < lines_.size(); ++i) {
+        if (lines_[i].line == line) {
+            cursor_.seek(lines_[i].token);
+            return true;
+        }
+    }
+    return false;
+}
 
 /**
- * skip_char
+ * reset
  *
- * Advances input position by one character
+ * Moves back to the first token, reading a streamed source again from
+ * its start
  *
  * @param void
  * @return void
  */
-void Tokenizer::skip_char() { io_->next(); }
+void Tokenizer::reset() {
+    TRACE_LOG(LEXER, "Resetting tokenizer");
+    ++resets_;
+    if (streaming()) {
+        seek_window(0, 0);
+    } else {
+        cursor_.reset();
+    }
+}
 
 /**
  * token_to_string
@@ -143,10 +744,32 @@ std::string_view Tokenizer::token_to_string(TokenType token) const {
             return "REM";
         case TokenType::GOTO:
             return "GOTO";
+        case TokenType::ON:
+            return "ON";
+        case TokenType::GOSUB:
+            return "GOSUB";
+        case TokenType::RETURN:
+            return "RETURN";
+        case TokenType::FOR:
+            return "FOR";
+        case TokenType::TO:
+            return "TO";
+        case TokenType::STEP:
+            return "STEP";
+        case TokenType::NEXT:
+            return "NEXT";
+        case TokenType::WHILE:
+            return "WHILE";
+        case TokenType::WEND:
+            return "WEND";
+        case TokenType::DIM:
+            return "DIM";
         case TokenType::LEFT_PAREN:
             return "LEFT_PAREN";
         case TokenType::RIGHT_PAREN:
             return "RIGHT_PAREN";
+        case TokenType::COLON:
+            return "COLON";
         case TokenType::EOL:
             return "EOL";
         default:
@@ -155,50 +778,37 @@ std::string_view Tokenizer::token_to_string(TokenType token) const {
 }
 
 /**
- * get_token_data
+ * finished
  *
- * Retrieves current token's associated data
+ * Checks if tokenizer has reached end of input
  *
  * @param void
- * @return Reference to variant containing:
- * - Empty state (monostate)
- * - String value
- * - Integer value
- * - Character value
+ * @return true if current token is EOF_TOKEN
  */
-const Tokenizer::TokenData& Tokenizer::get_token_data() const {
-    return token_data_;
-}
+bool Tokenizer::finished() const { return cursor_.at_end(); }
 
 /**
- * finished
- *
- * Checks if tokenizer has reached end of input
+ * is_line_number
  *
  * @param void
- * @return true if current token is EOF_TOKEN
+ * @return true if the current token is the number that starts a line
  */
-bool Tokenizer::finished() const {
-    return current_token_ == TokenType::EOF_TOKEN;
+bool Tokenizer::is_line_number() const {
+    const Token& current = token();
+    return current.type == TokenType::NUMBER && (current.flags & LINE_START);
 }
 
 /**
  * variable_num
  *
- * Converts current letter token to variable number (0-25)
+ * Gets the variable slot of the current letter token (0-25)
  * 'a'=0, 'b'=1, etc.
  *
  * @param void
  * @return Variable index 0-25, or 0 if not a letter token
  */
 int Tokenizer::variable_num() const {
-    if (std::holds_alternative<char>(token_data_)) {
-        char letter = std::get<char>(token_data_);
-        if (letter >= 'a' && letter <= 'z') {
-            return letter - 'a';
-        }
-    }
-    return 0;
+    return current_token() == TokenType::LETTER ? token().value : 0;
 }
 
 /**
@@ -211,11 +821,39 @@ int Tokenizer::variable_num() const {
  *         empty string otherwise
  */
 std::string_view Tokenizer::get_string() const {
-    static const std::string empty;
-    if (std::holds_alternative<std::string>(token_data_)) {
-        return std::get<std::string>(token_data_);
+    if (current_token() != TokenType::STRING) {
+        return {};
     }
-    return empty;
+    return literal(token().value);
+}
+
+/**
+ * literal
+ *
+ * @param index The value of a STRING token
+ * @return The string's text in the literal pool
+ */
+std::string_view Tokenizer::literal(std::int32_t index) const {
+    const auto i = static_cast<std::size_t>(index);
+    const std::uint32_t begin = i ? literal_ends_[i - 1] : 0;
+    return std::string_view(literal_pool_)
+      .substr(begin, literal_ends_[i] - begin);
+}
+
+/**
+ * link
+ *
+ * @param token Index of the NUMBER after a THEN or GOTO, of the GOTO of
+ *        an ON statement, or of a FOR, WHILE or WEND
+ * @param value Index of the line number token of the line the NUMBER
+ *        names, the number of targets the GOTO lists, the index of the
+ *        token that ends the loop's NEXT or WEND statement, or for a WEND
+ *        the index of the token its WHILE's line starts at
+ * @return void
+ */
+void Tokenizer::link(std::size_t token, std::uint32_t value) {
+    tokens_[token].value = static_cast<std::int32_t>(value);
+    tokens_[token].flags |= LINKED;
 }
 
 /**
@@ -228,59 +866,55 @@ std::string_view Tokenizer::get_string() const {
  *         0 otherwise
  */
 int Tokenizer::get_num() const {
-    if (std::holds_alternative<int>(token_data_)) {
-        return std::get<int>(token_data_);
-    }
-    return 0;
+    return current_token() == TokenType::NUMBER ? token().value : 0;
+}
+
+/**
+ * location
+ *
+ * Looks a token up in the location table. This is a binary search, which
+ * is fine for error messages and nothing else.
+ *
+ * @param index The token's position in the token array
+ * @return The token's source line and column
+ */
+Tokenizer::Location Tokenizer::location(std::size_t index) const {
+    const auto after =
+      std::upper_bound(line_tokens_.begin(), line_tokens_.end(), index);
+    const auto line = static_cast<std::uint32_t>(after - line_tokens_.begin());
+    return { lines_before_ + line, columns_[index] };
 }
 
 /**
  * next_token
  *
- * Advances to next token in input
- * - Skips whitespace (space/tab but not newline)
- * - Updates current token
+ * Advances to next token in the array
+ * - Moves on to the next window at the end of a streamed one
  * - Does nothing if already at EOF
  *
  * @param void
  * @return void
  */
 void Tokenizer::next_token() {
-    if (finished()) {
-        return;
-    }
-    // Skip spaces and tabs, but not newlines
-    while (!io_->eof() && (io_->current() == ' ' || io_->current() == '\t')) {
-        io_->next();
+    cursor_.next();
+    if (cursor_.at_end()) [[unlikely]] {
+        next_window();
     }
-    current_token_ = get_next_token();
 }
 
 /**
  * skip_to_eol
  *
- * Skips all input until end of current line
- * - Handles both \n and \r\n line endings
- * - Updates current token after skipping
+ * Skips all tokens until the end of the current line and moves past it
  *
  * @param void
  * @return void
  */
 void Tokenizer::skip_to_eol() {
-    while (!io_->eof() && io_->current() != '\n' && io_->current() != '\r') {
-        io_->next();
-    }
-    if (!io_->eof()) {
-        if (io_->current() == '\r') {
-            io_->next();
-            if (!io_->eof() && io_->current() == '\n') {
-                io_->next();
-            }
-        } else if (io_->current() == '\n') {
-            io_->next();
-        }
+    while (!finished() && current_token() != TokenType::EOL) {
+        cursor_.advance();
     }
-    current_token_ = get_next_token();
+    next_token();
 }
 
 /**
@@ -289,10 +923,10 @@ void Tokenizer::skip_to_eol() {
  * Reads and classifies next token from input
  *
  * @param void
- * @return TokenType of next token
+ * @return The next token, with its data filled in
  * Updates:
  * - Input stream position
- * - Token data as needed
+ * - The column table
  *
  * Handles:
  * - Whitespace skipping
@@ -302,111 +936,133 @@ void Tokenizer::skip_to_eol() {
  * - Operators and symbols
  * - Line endings
  */
-Tokenizer::TokenType Tokenizer::get_next_token() {
-    if (io_->eof()) {
-        return TokenType::EOF_TOKEN;
-    }
-    char c = io_->current();
-    DEBUG_LOG("get_next_token processing char: '"
-              << (std::isprint(c) ? c : ' ')
-              << "' (ASCII: " << static_cast<int>(c) << ")");
+Tokenizer::Token Tokenizer::Lexer::get_next_token() {
+    Token token{ TokenType::EOF_TOKEN, 0, 0, 0 };
     // Skip spaces and tabs, but not newlines
-    while (!io_->eof() && (c == ' ' || c == '\t')) {
-        io_->next();
-        c = io_->current();
+    while (*source_ == ' ' || *source_ == '\t') {
+        source_.advance();
     }
+    columns_.push_back(
+      static_cast<std::uint32_t>(source_.offset() - line_begin_ + 1));
+    if (source_.at_end()) {
+        return token;
+    }
+    token.type = next_token_type(token.value);
+    if (token.type == TokenType::EOL) {
+        line_begin_ = source_.offset();
+    }
+    return token;
+}
+
+/**
+ * next_token_type
+ *
+ * Classifies the token that starts at the current character, which is not
+ * a space, and reads past it
+ *
+ * @param value Set to the token's number, variable slot or literal index
+ * @return TokenType of the token read
+ */
+Tokenizer::TokenType Tokenizer::Lexer::next_token_type(std::int32_t& value) {
+    const char c = *source_;
+    TRACE_LOG(LEXER,
+              "get_next_token processing char: '"
+                << (std::isprint(c) ? c : ' ') << "' (ASCII: "
+                << static_cast<int>(c) << ")");
     // Handle EOL
     if (c == '\n' || c == '\r') {
-        if (c == '\r') {
-            io_->next();
-            if (!io_->eof() && io_->current() == '\n') {
-                io_->next();
-            }
-        } else {
-            io_->next();
+        source_.advance();
+        if (c == '\r' && *source_ == '\n') {
+            source_.advance();
         }
         return TokenType::EOL;
     }
     // Handle quoted strings
     if (c == '"') {
-        return token_string();
+        return token_string(value);
     }
     // Handle numbers
     if (std::isdigit(c)) {
-        return token_number();
+        return token_number(value);
     }
     // Handle keywords and variables
     if (std::isalpha(c)) {
         if (std::isupper(c)) {
-            return token_keyword();
+            const TokenType keyword = token_keyword();
+            if (keyword == TokenType::REM) {
+                skip_comment();
+            }
+            return keyword;
         } else {
-            token_data_ = c;
-            io_->next();
+            value = c - 'a';
+            source_.advance();
             return TokenType::LETTER;
         }
     }
     // Handle separators
     if (c == ',' || c == ';') {
-        io_->next();
-        DEBUG_LOG("Found separator");
+        source_.advance();
+        TRACE_LOG(LEXER, "Found separator");
         return TokenType::SEPARATOR;
     }
     // Handle operators and other tokens
     TokenType token = TokenType::ERROR;
     switch (c) {
         case '=':
-            io_->next();
+            source_.advance();
             token = TokenType::EQUAL;
             break;
         case '<':
-            io_->next();
-            if (!io_->eof()) {
-                if (io_->current() == '=') {
-                    io_->next();
-                    token = TokenType::LT_EQ;
-                } else if (io_->current() == '>') {
-                    io_->next();
-                    token = TokenType::NOT_EQUAL;
-                } else {
-                    token = TokenType::LT;
-                }
+            source_.advance();
+            if (*source_ == '=') {
+                source_.advance();
+                token = TokenType::LT_EQ;
+            } else if (*source_ == '>') {
+                source_.advance();
+                token = TokenType::NOT_EQUAL;
+            } else {
+                token = TokenType::LT;
             }
             break;
         case '>':
-            io_->next();
-            if (!io_->eof() && io_->current() == '=') {
-                io_->next();
+            source_.advance();
+            if (*source_ == '=') {
+                source_.advance();
                 token = TokenType::GT_EQ;
             } else {
                 token = TokenType::GT;
             }
             break;
         case '+':
-            io_->next();
+            source_.advance();
             token = TokenType::PLUS;
             break;
         case '-':
-            io_->next();
+            source_.advance();
             token = TokenType::MINUS;
             break;
         case '*':
-            io_->next();
+            source_.advance();
             token = TokenType::ASTERISK;
             break;
         case '/':
-            io_->next();
+            source_.advance();
             token = TokenType::SLASH;
             break;
         case '(':
-            io_->next();
+            source_.advance();
             token = TokenType::LEFT_PAREN;
             break;
         case ')':
-            io_->next();
+            source_.advance();
             token = TokenType::RIGHT_PAREN;
             break;
+        case ':':
+            source_.advance();
+            token = TokenType::COLON;
+            break;
         default:
-            io_->next();
+            source_.advance();
             token = TokenType::ERROR;
     }
     return token;
@@ -415,84 +1071,94 @@ Tokenizer::TokenType Tokenizer::get_next_token() {
 /**
  * token_string
  *
- * Processes a string literal token
+ * Processes a string literal token into the literal pool
  *
- * @param void
+ * @param value Set to the literal's index in the pool
  * @return TokenType::STRING
  *
  * Assumes current char is opening quote
  * Reads until closing quote or EOF
  * Handles:
  * - Max string length (SUBARUU_STRING_LITERAL)
- * - Whitespace after string
  * - Unclosed strings preserved as-is
  */
-Tokenizer::TokenType Tokenizer::token_string() {
-    std::string str;
-    io_->next(); // Skip initial quote
-    while (!io_->eof()) {
-        char c = io_->current();
+Tokenizer::TokenType Tokenizer::Lexer::token_string(std::int32_t& value) {
+    value = static_cast<std::int32_t>(literal_ends_.size());
+    const std::size_t begin = literal_pool_.size();
+    source_.advance(); // Skip initial quote
+    while (true) {
+        const char c = *source_;
         if (c == '"') {
-            io_->next();
-            token_data_ = str;
-            while (!io_->eof() &&
-                   (io_->current() == ' ' || io_->current() == '\t')) {
-                io_->next();
-            }
-            return TokenType::STRING;
+            source_.advance();
+            break;
+        }
+        if (c == '\0' && source_.at_end()) {
+            break;
         }
-        if (str.size() >= SUBARUU_STRING_LITERAL) {
+        if (literal_pool_.size() - begin >= SUBARUU_STRING_LITERAL) {
             break;
         }
-        str += c;
-        io_->next();
+        literal_pool_ += c;
+        source_.advance();
     }
-    token_data_ = str;
+    literal_ends_.push_back(static_cast<std::uint32_t>(literal_pool_.size()));
     return TokenType::STRING;
 }
 
+/**
+ * skip_comment
+ *
+ * Skips the text of a REM up to, but not including, the end of the line
+ *
+ * @param void
+ * @return void
+ */
+void Tokenizer::Lexer::skip_comment() {
+    while (true) {
+        const char c = *source_;
+        if (c == '\n' || c == '\r' || (c == '\0' && source_.at_end())) {
+            break;
+        }
+        source_.advance();
+    }
+}
+
 /**
  * token_keyword
  *
- * Processes a language keyword token
+ * Processes a language keyword token, matching the word in place against
+ * the keyword table
  *
  * @param void
  * @return TokenType for matching keyword or ERROR
  *
  * Handles:
  * - Case-insensitive matching
- * - Leading/trailing whitespace
+ * - Trailing whitespace
  * - Special REM keyword behavior
  */
-Tokenizer::TokenType Tokenizer::token_keyword() {
-    DEBUG_LOG("Processing possible keyword");
-    std::string keyword;
-
-    while (!io_->eof() && (io_->current() == ' ' || io_->current() == '\t')) {
-        io_->next();
-    }
-    while (!io_->eof() && std::isalpha(io_->current())) {
-        keyword += static_cast<char>(std::toupper(io_->current()));
-        io_->next();
-    }
-    DEBUG_LOG("Found possible keyword: " << keyword);
-    std::string_view keyword_view(keyword);
-    if (keyword_view == "REM") {
-        return TokenType::REM;
-    }
-    while (!io_->eof() && (io_->current() == ' ' || io_->current() == '\t')) {
-        io_->next();
-    }
-    if (keyword_view == "PRINT")
-        return TokenType::PRINT;
-    if (keyword_view == "LET")
-        return TokenType::LET;
-    if (keyword_view == "IF")
-        return TokenType::IF;
-    if (keyword_view == "THEN")
-        return TokenType::THEN;
-    if (keyword_view == "GOTO")
-        return TokenType::GOTO;
+Tokenizer::TokenType Tokenizer::Lexer::token_keyword() {
+    TRACE_LOG(LEXER, "Processing possible keyword");
+    const char* const begin = &*source_;
+    while (std::isalpha(*source_)) {
+        source_.advance();
+    }
+    const std::string_view word(begin, &*source_ - begin);
+    TRACE_LOG(LEXER, "Found possible keyword: " << word);
+    for (const KeywordToken& keyword : KEYWORDS) {
+        if (!is_keyword(word, keyword.keyword)) {
+            continue;
+        }
+        if (keyword.token != TokenType::REM) {
+            while (*source_ == ' ' || *source_ == '\t') {
+                source_.advance();
+            }
+        }
+        return keyword.token;
+    }
+    while (*source_ == ' ' || *source_ == '\t') {
+        source_.advance();
+    }
     return TokenType::ERROR;
 }
 
@@ -501,37 +1167,22 @@ Tokenizer::TokenType Tokenizer::token_keyword() {
  *
  * Processes a numeric literal token
  *
- * @param void
- * @return TokenType::NUMBER or ERROR
+ * @param value Set to the number read
+ * @return TokenType::NUMBER
  *
  * Handles:
- * - Leading/trailing whitespace
- * - Max number length (SUBARUU_NUMBER_LITERAL)
- * - Invalid number formats
- * Updates token_data with parsed value
- */
-Tokenizer::TokenType Tokenizer::token_number() {
-    std::string num_str;
-    while (!io_->eof() && (io_->current() == ' ' || io_->current() == '\t')) {
-        io_->next();
-    }
-    while (!io_->eof() && std::isdigit(io_->current()) &&
-           num_str.size() < SUBARUU_NUMBER_LITERAL) {
-        num_str += io_->current();
-        io_->next();
-    }
-    if (!num_str.empty()) {
-        try {
-            token_data_ = std::stoi(num_str);
-
-            while (!io_->eof() &&
-                   (io_->current() == ' ' || io_->current() == '\t')) {
-                io_->next();
-            }
-            return TokenType::NUMBER;
-        } catch (const std::exception&) {
-            return TokenType::ERROR;
-        }
+ * - Max number length (SUBARUU_NUMBER_LITERAL); the digits after it start
+ *   the next number
+ */
+Tokenizer::TokenType Tokenizer::Lexer::token_number(std::int32_t& value) {
+    static_assert(SUBARUU_NUMBER_LITERAL <= 9,
+                  "Number literals must not overflow an int");
+    value = 0;
+    for (std::size_t digits = 0;
+         std::isdigit(*source_) && digits < SUBARUU_NUMBER_LITERAL;
+         ++digits) {
+        value = value * 10 + (*source_ - '0');
+        source_.advance();
     }
-    return TokenType::ERROR;
+    return TokenType::NUMBER;
 }
@@ -0,0 +1,216 @@
+#include "../include/trace_log.h"
+
+#include <stdexcept>
+#include <string>
+
+/******************************************************************************/
+
+namespace {
+// Every category, in the order they are listed.
+constexpr TraceCategory CATEGORIES[] = {
+    TraceCategory::LEXER,     TraceCategory::PARSER, TraceCategory::JUMPS,
+    TraceCategory::VARIABLES, TraceCategory::OUTPUT,
+};
+} // namespace
+
+/**
+ * trace_category_name
+ *
+ * @param category The category to name
+ * @return Its name, as given to -log
+ */
+const char* trace_category_name(TraceCategory category) noexcept {
+    switch (category) {
+        case TraceCategory::LEXER:
+            return "lexer";
+        case TraceCategory::PARSER:
+            return "parser";
+        case TraceCategory::JUMPS:
+            return "jumps";
+        case TraceCategory::VARIABLES:
+            return "variables";
+        case TraceCategory::OUTPUT:
+            return "output";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * parse_trace_categories
+ *
+ * @param list Comma separated category names, or "all"
+ * @param mask Set to the matching categories
+ * @return false if a name is not a category; mask is left alone
+ */
+bool parse_trace_categories(std::string_view list, unsigned& mask) {
+    unsigned parsed = 0;
+    while (!list.empty()) {
+        const std::size_t comma = list.find(',');
+        const std::string_view name = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view()
+                                               : list.substr(comma + 1);
+        if (name == "all") {
+            parsed |= TRACE_ALL;
+            continue;
+        }
+        bool found = false;
+        for (TraceCategory category : CATEGORIES) {
+            if (name == trace_category_name(category)) {
+                parsed |= static_cast<unsigned>(category);
+                found = true;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    mask = parsed;
+    return true;
+}
+
+/**
+ * Buffer Constructor
+ *
+ * @param file Where full buffers are written
+ */
+TraceLog::Buffer::Buffer(std::FILE* file)
+  : file_(file) {
+    setp(data_, data_ + sizeof(data_));
+}
+
+/**
+ * set_file
+ *
+ * Writes out what is buffered, then switches files.
+ *
+ * @param file Where later buffers are written
+ * @return void
+ */
+void TraceLog::Buffer::set_file(std::FILE* file) noexcept {
+    write_out();
+    file_ = file;
+}
+
+/**
+ * write_out
+ *
+ * @param void
+ * @return void
+ */
+void TraceLog::Buffer::write_out() noexcept {
+    const std::size_t size = pptr() - pbase();
+    if (size) {
+        std::fwrite(pbase(), 1, size, file_);
+    }
+    setp(data_, data_ + sizeof(data_));
+}
+
+/**
+ * overflow
+ *
+ * Called when the buffer is full.
+ *
+ * @param c The character that did not fit
+ * @return c, or not_eof for EOF
+ */
+TraceLog::Buffer::int_type TraceLog::Buffer::overflow(int_type c) {
+    write_out();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        sputc(traits_type::to_char_type(c));
+    }
+    return traits_type::not_eof(c);
+}
+
+/**
+ * sync
+ *
+ * @param void
+ * @return 0
+ */
+int TraceLog::Buffer::sync() {
+    write_out();
+    std::fflush(file_);
+    return 0;
+}
+
+/**
+ * TraceLog Constructor
+ *
+ * Logs to stderr until open() is called
+ */
+TraceLog::TraceLog()
+  : buffer_(stderr)
+  , stream_(&buffer_)
+  , owns_file_(false) {}
+
+/**
+ * TraceLog Destructor
+ *
+ * Writes out the rest of the log
+ */
+TraceLog::~TraceLog() {
+    flush();
+    if (owns_file_) {
+        std::fclose(buffer_.file());
+    }
+}
+
+/**
+ * open
+ *
+ * @param path The file to log to
+ * @return void
+ * @throws std::runtime_error If the file cannot be opened
+ */
+void TraceLog::open(std::string_view path) {
+    std::FILE* file = std::fopen(std::string(path).c_str(), "w");
+    if (!file) {
+        throw std::runtime_error("Failed to open file: " + std::string(path));
+    }
+    std::FILE* previous = buffer_.file();
+    buffer_.set_file(file);
+    if (owns_file_) {
+        std::fclose(previous);
+    }
+    owns_file_ = true;
+}
+
+/**
+ * begin
+ *
+ * @param category The category of the record
+ * @return The stream to write the message to
+ */
+std::ostream& TraceLog::begin(TraceCategory category) {
+    return stream_ << trace_category_name(category) << ": ";
+}
+
+/**
+ * end
+ *
+ * Ends the record started by begin().
+ *
+ * @param void
+ * @return void
+ */
+void TraceLog::end() { stream_.put('\n'); }
+
+/**
+ * flush
+ *
+ * @param void
+ * @return void
+ */
+void TraceLog::flush() noexcept { buffer_.pubsync(); }
+
+/**
+ * trace_log
+ *
+ * @param void
+ * @return The process-wide trace log
+ */
+TraceLog& trace_log() {
+    static TraceLog log;
+    return log;
+}
@@ -0,0 +1,258 @@
+#include "../include/tracer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+/******************************************************************************/
+
+namespace {
+// The buffer is written out once it holds this much.
+constexpr std::size_t WRITE_THRESHOLD = 1 << 16;
+// Names and categories are cut to these lengths, which keeps any one
+// event under MAX_EVENT_BYTES. The buffer never holds more than an event
+// past WRITE_THRESHOLD, so with that much reserved up front appending to
+// it never allocates, and the functions that do so cannot throw.
+constexpr std::size_t MAX_NAME_BYTES = 64;
+constexpr std::size_t MAX_CATEGORY_BYTES = 16;
+constexpr std::size_t MAX_EVENT_BYTES = 256;
+} // namespace
+
+/**
+ * Tracer Constructor
+ *
+ * @param path The trace file to write
+ * @param sample_every Keep one line block and one flush in this many
+ * @param max_events Events past this many are counted but not written
+ * @throws std::runtime_error If the file cannot be opened
+ */
+Tracer::Tracer(std::string_view path,
+               std::uint64_t sample_every,
+               std::uint64_t max_events)
+  : file_(std::fopen(std::string(path).c_str(), "wb"))
+  , origin_(Clock::now())
+  , sample_every_(std::max<std::uint64_t>(1, sample_every))
+  , max_events_(max_events) {
+    if (!file_) {
+        throw std::runtime_error("Failed to open file: " + std::string(path));
+    }
+    buffer_.reserve(WRITE_THRESHOLD + MAX_EVENT_BYTES);
+    buffer_ += "[\n";
+}
+
+/**
+ * Tracer Destructor
+ *
+ * Terminates the trace and closes the file
+ */
+Tracer::~Tracer() { close(); }
+
+/**
+ * reserve_event
+ *
+ * @param void
+ * @return true if another event may be written, false once the limit has
+ *         been reached, in which case the event is counted as dropped
+ */
+bool Tracer::reserve_event() noexcept {
+    if (events_ >= max_events_) {
+        ++dropped_;
+        return false;
+    }
+    ++events_;
+    return true;
+}
+
+/**
+ * append_number
+ *
+ * @param value The number to append to the buffer
+ * @return void
+ */
+void Tracer::append_number(std::uint64_t value) {
+    char digits[24];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer_.append(digits, result.ptr);
+}
+
+/**
+ * append_micros
+ *
+ * Trace timestamps are in microseconds; three decimals keep nanoseconds.
+ *
+ * @param duration The time to append
+ * @return void
+ */
+void Tracer::append_micros(Clock::duration duration) {
+    const auto nanos = static_cast<std::uint64_t>(std::max<std::int64_t>(
+      0,
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+    append_number(nanos / 1000);
+    const std::uint64_t fraction = nanos % 1000;
+    buffer_ += '.';
+    buffer_ += static_cast<char>('0' + fraction / 100);
+    buffer_ += static_cast<char>('0' + fraction / 10 % 10);
+    buffer_ += static_cast<char>('0' + fraction % 10);
+}
+
+/**
+ * append_event
+ *
+ * Formats a complete ("X") event, leaving the closing brace to the caller
+ * so it can add arguments. The name and category are cut to fit.
+ *
+ * @param name Event name
+ * @param category Event category
+ * @param start When the event started
+ * @param end When the event ended
+ * @return void
+ */
+void Tracer::append_event(std::string_view name,
+                          const char* category,
+                          Clock::time_point start,
+                          Clock::time_point end) {
+    buffer_ += events_ > 1 ? ",\n{\"name\":\"" : "{\"name\":\"";
+    buffer_ += name.substr(0, MAX_NAME_BYTES);
+    buffer_ += "\",\"cat\":\"";
+    buffer_ += std::string_view(category).substr(0, MAX_CATEGORY_BYTES);
+    buffer_ += "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":";
+    append_micros(start - origin_);
+    buffer_ += ",\"dur\":";
+    append_micros(end - start);
+}
+
+/**
+ * complete
+ *
+ * @param name Event name
+ * @param category Event category
+ * @param start When the event started; it ends now
+ * @return void
+ */
+void Tracer::complete(const char* name,
+                      const char* category,
+                      Clock::time_point start) noexcept {
+    const auto end = Clock::now();
+    if (!reserve_event()) {
+        return;
+    }
+    append_event(name, category, start, end);
+    buffer_ += '}';
+    if (buffer_.size() >= WRITE_THRESHOLD) {
+        write_buffer();
+    }
+}
+
+/**
+ * open_block
+ *
+ * Starts a line block, reading the clock only if it is sampled.
+ *
+ * @param line The first line of the block
+ * @return void
+ */
+void Tracer::open_block(int line) {
+    block_sampled_ = blocks_++ % sample_every_ == 0;
+    first_line_ = line;
+    if (block_sampled_) {
+        block_start_ = Clock::now();
+    }
+}
+
+/**
+ * close_block
+ *
+ * Writes the open block as an event named after its first and last line.
+ *
+ * @param void
+ * @return void
+ */
+void Tracer::close_block() noexcept {
+    const std::uint64_t lines = block_lines_;
+    block_lines_ = 0;
+    if (!block_sampled_) {
+        return;
+    }
+    const auto end = Clock::now();
+    if (!reserve_event()) {
+        return;
+    }
+    // Formatted in place, as a std::string could throw
+    char name[32] = "line ";
+    char* const last = name + sizeof(name);
+    char* cursor = std::to_chars(name + 5, last, first_line_).ptr;
+    if (last_line_ != first_line_ && cursor != last) {
+        *cursor++ = '-';
+        cursor = std::to_chars(cursor, last, last_line_).ptr;
+    }
+    append_event(std::string_view(name, cursor - name),
+                 "exec",
+                 block_start_,
+                 end);
+    buffer_ += ",\"args\":{\"lines\":";
+    append_number(lines);
+    buffer_ += "}}";
+    if (buffer_.size() >= WRITE_THRESHOLD) {
+        write_buffer();
+    }
+}
+
+/**
+ * write_buffer
+ *
+ * @param void
+ * @return void
+ */
+void Tracer::write_buffer() noexcept {
+    if (file_ && !buffer_.empty()) {
+        std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+    }
+    buffer_.clear();
+}
+
+/**
+ * finish
+ *
+ * Closes the open line block and writes out the buffer. Tracing can go on
+ * afterwards.
+ *
+ * @param void
+ * @return void
+ */
+void Tracer::finish() noexcept {
+    jump();
+    write_buffer();
+    if (file_) {
+        std::fflush(file_);
+    }
+}
+
+/**
+ * close
+ *
+ * Finishes, records how many events were dropped and terminates the JSON
+ * array. Calling it again is harmless.
+ *
+ * @param void
+ * @return void
+ */
+void Tracer::close() noexcept {
+    if (!file_) {
+        return;
+    }
+    jump();
+    write_buffer(); // Room for the record below
+    if (dropped_) {
+        buffer_ += events_ ? ",\n" : "";
+        buffer_ += "{\"name\":\"dropped events\",\"cat\":\"trace\","
+                   "\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":1,\"ts\":";
+        append_micros(Clock::now() - origin_);
+        buffer_ += ",\"args\":{\"dropped\":";
+        append_number(dropped_);
+        buffer_ += "}}";
+    }
+    buffer_ += "\n]\n";
+    write_buffer();
+    std::fclose(file_);
+    file_ = nullptr;
+}
@@ -0,0 +1,33 @@
+#include "../../include/arena.h"
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("Arena Allocation", "[arena]") {
+    Arena arena;
+
+    SECTION("Arrays are zeroed and follow each other in a block") {
+        int* first = arena.allocate(3);
+        int* second = arena.allocate(5);
+        REQUIRE(second == first + 3);
+        for (int i = 0; i < 5; ++i) {
+            REQUIRE(second[i] == 0);
+        }
+        first[2] = 7;
+        REQUIRE(second[0] == 0);
+    }
+
+    SECTION("An array that does not fit starts a new block") {
+        int* first = arena.allocate(SUBARUU_ARENA_BLOCK - 1);
+        int* second = arena.allocate(2);
+        REQUIRE(second != first + SUBARUU_ARENA_BLOCK - 1);
+        second[1] = 1;
+        REQUIRE(arena.allocate(1) == second + 2);
+    }
+
+    SECTION("An array bigger than a block gets its own") {
+        int* small = arena.allocate(1);
+        int* large = arena.allocate(SUBARUU_ARENA_BLOCK + 1);
+        large[SUBARUU_ARENA_BLOCK] = 1;
+        REQUIRE(large[0] == 0);
+        REQUIRE(arena.allocate(1) == small + 1);
+    }
+}
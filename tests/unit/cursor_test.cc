@@ -0,0 +1,52 @@
+#include "../../include/cursor.h"
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+TEST_CASE("Cursor Over Characters", "[cursor]") {
+    const std::string text = "ab";
+    Cursor<char> cursor(text.data(), text.data() + text.size());
+
+    SECTION("Reading and moving") {
+        REQUIRE(*cursor == 'a');
+        REQUIRE(cursor.peek() == 'b');
+        cursor.advance();
+        REQUIRE(*cursor == 'b');
+        REQUIRE(cursor.offset() == 1);
+        REQUIRE_FALSE(cursor.at_end());
+    }
+
+    SECTION("The sentinel ends the buffer and stays put") {
+        cursor.advance();
+        cursor.advance();
+        REQUIRE(cursor.at_end());
+        REQUIRE(*cursor == '\0');
+        REQUIRE(cursor.peek() == '\0');
+        cursor.next();
+        REQUIRE(cursor.at_end());
+        REQUIRE(cursor.offset() == text.size());
+    }
+
+    SECTION("Seek and reset") {
+        cursor.seek(1);
+        REQUIRE(*cursor == 'b');
+        cursor.reset();
+        REQUIRE(*cursor == 'a');
+        REQUIRE(cursor.size() == 2);
+    }
+}
+
+TEST_CASE("Cursor Over Records", "[cursor]") {
+    struct Item {
+            int value;
+    };
+    const Item items[] = { { 1 }, { 2 }, { -1 } };
+    Cursor<Item> cursor(items, items + 2);
+
+    SECTION("Members are read through the cursor") {
+        REQUIRE(cursor->value == 1);
+        cursor.next();
+        cursor.next();
+        REQUIRE(cursor.at_end());
+        REQUIRE(cursor->value == -1);
+    }
+}
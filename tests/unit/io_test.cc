@@ -1,5 +1,7 @@
 #include "../../include/io.h"
 #include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
 #include <string>
 
 TEST_CASE("IO Basic File Operations", "[io]") {
@@ -73,4 +75,50 @@ TEST_CASE("IO File Switching", "[io]") {
                           std::runtime_error);
     }
 }
+
+TEST_CASE("IO Streaming Windows", "[io]") {
+    std::string temp_filename = "temp_stream_windows.subaru";
+    const std::string source = "10 PRINT 1\n"
+                               "20 PRINT \"a line longer than a window\"\n"
+                               "30 PRINT 3\n"
+                               "40 PRINT 4";
+    std::ofstream temp_file(temp_filename);
+    temp_file << source;
+    temp_file.close();
+
+    SECTION("Nothing is read until the first window") {
+        IO io(temp_filename, 8);
+        REQUIRE(io.streaming());
+        REQUIRE(io.size() == 0);
+    }
+
+    SECTION("Windows hold whole lines and add up to the file") {
+        IO io(temp_filename, 8);
+        std::string joined;
+        while (io.next_window()) {
+            REQUIRE(io.window_offset() == joined.size());
+            const std::string window(io.data(), io.size());
+            // Every line here is longer than the window
+            if (window.back() == '\n') {
+                REQUIRE(window.find('\n') == window.size() - 1);
+            } else {
+                REQUIRE(joined.size() + window.size() == source.size());
+            }
+            joined += window;
+        }
+        REQUIRE(joined == source);
+    }
+
+    SECTION("A window can be read again from a line start") {
+        IO io(temp_filename, 8);
+        while (io.next_window()) {
+        }
+        REQUIRE(io.seek_window(11));
+        REQUIRE(std::string(io.data(), io.size()) ==
+                "20 PRINT \"a line longer than a window\"\n");
+        REQUIRE(io.next_window());
+        REQUIRE(std::string(io.data(), io.size()) == "30 PRINT 3\n");
+    }
+    std::filesystem::remove(temp_filename);
+}
 #define CATCH_CONFIG_MAIN
@@ -0,0 +1,91 @@
+#include "../../include/line_table.h"
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+
+TEST_CASE("Line Table Lookup", "[line_table]") {
+    LineTable table;
+
+    SECTION("Dense multiples of the stride are slotted") {
+        table.add(10, 0);
+        table.add(20, 4);
+        table.add(40, 9);
+        table.index();
+        REQUIRE(table.dense());
+        REQUIRE(table[table.find(20)].token == 4);
+        REQUIRE(table[table.find(40)].token == 9);
+        REQUIRE(table.find(30) == LineTable::NONE);
+        REQUIRE(table.find(25) == LineTable::NONE);
+        REQUIRE(table.find(0) == LineTable::NONE);
+        REQUIRE(table.find(-10) == LineTable::NONE);
+        REQUIRE(table.find(50) == LineTable::NONE);
+    }
+
+    SECTION("Sparse or odd numbers are searched") {
+        table.add(10, 0);
+        table.add(15, 3);
+        table.add(100000, 6);
+        table.index();
+        REQUIRE_FALSE(table.dense());
+        REQUIRE(table[table.find(15)].token == 3);
+        REQUIRE(table[table.find(100000)].token == 6);
+        REQUIRE(table.find(20) == LineTable::NONE);
+    }
+
+    SECTION("Lines added later extend the slots") {
+        table.add(10, 0);
+        table.index();
+        table.add(20, 2);
+        table.add(30, 5);
+        table.index();
+        REQUIRE(table.dense());
+        REQUIRE(table[table.find(30)].token == 5);
+        table.add(35, 8);
+        table.index();
+        REQUIRE_FALSE(table.dense());
+        REQUIRE(table[table.find(35)].token == 8);
+        REQUIRE(table[table.find(10)].token == 0);
+    }
+
+    SECTION("Lines out of order are sorted, and numbered in program order") {
+        table.add(30, 0);
+        table.add(10, 3);
+        table.index();
+        table.add(20, 6);
+        table.index();
+        REQUIRE(table.size() == 3);
+        REQUIRE(table[0].line == 10);
+        REQUIRE(table[table.find(20)].token == 6);
+        REQUIRE(table.numbers() == std::vector<int>{ 30, 10, 20 });
+    }
+
+    SECTION("A number used twice finds its first line") {
+        table.add(20, 0);
+        table.add(10, 2);
+        table.add(20, 5);
+        table.index();
+        REQUIRE(table[table.find(20)].token == 0);
+        REQUIRE(table.numbers() == std::vector<int>{ 20, 10, 20 });
+    }
+
+    SECTION("Computed lookups in a sparse table see lines added later") {
+        table.add(10, 0);
+        table.add(15, 3);
+        table.index();
+        REQUIRE(table.lookup(15) == table.find(15));
+        REQUIRE(table.lookup(25) == LineTable::NONE);
+        REQUIRE(table.lookup(25) == LineTable::NONE);
+        table.add(25, 6);
+        table.index();
+        REQUIRE(table[table.lookup(25)].token == 6);
+        REQUIRE(table[table.lookup(10)].token == 0);
+    }
+
+    SECTION("Clear empties the table") {
+        table.add(10, 0);
+        table.index();
+        table.clear();
+        REQUIRE(table.empty());
+        REQUIRE(table.find(10) == LineTable::NONE);
+        REQUIRE(table.numbers().empty());
+    }
+}
@@ -0,0 +1,88 @@
+#include "../../include/perf_counters.h"
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// Counters are often denied in containers and CI, so every case has to hold
+// whether open() succeeds or not.
+
+TEST_CASE("PerfCounters Opening", "[perf_counters]") {
+    PerfCounters counters;
+
+    SECTION("Either counts or says why not") {
+        const bool opened = counters.open();
+        REQUIRE(opened == counters.available());
+        REQUIRE(opened == counters.error().empty());
+        if (opened) {
+            bool any = false;
+            for (int event = 0; event < PerfCounters::EVENT_COUNT; ++event) {
+                const auto e = static_cast<PerfCounters::Event>(event);
+                any = any || counters.supported(e);
+            }
+            REQUIRE(any);
+        }
+    }
+
+    SECTION("Closed counters count nothing") {
+        counters.open();
+        counters.close();
+        REQUIRE_FALSE(counters.available());
+        counters.enter(10);
+        counters.finish();
+        REQUIRE(counters.lines().empty());
+    }
+}
+
+TEST_CASE("PerfCounters Line Accounting", "[perf_counters]") {
+    PerfCounters counters;
+    counters.seed({ 10, 20 });
+    REQUIRE(counters.lines().size() == 2);
+
+    if (!counters.open()) {
+        WARN("Hardware counters unavailable: " << counters.error());
+        return;
+    }
+    volatile std::uint64_t sink = 0;
+    counters.enter(10);
+    for (int i = 0; i < 100000; ++i) {
+        sink = sink + i;
+    }
+    counters.enter(20);
+    counters.enter(10);
+    counters.finish();
+
+    REQUIRE(counters.lines().at(10).hits == 2);
+    REQUIRE(counters.lines().at(20).hits == 1);
+    if (counters.supported(PerfCounters::INSTRUCTIONS)) {
+        REQUIRE(counters.lines().at(10).events[PerfCounters::INSTRUCTIONS] >
+                counters.lines().at(20).events[PerfCounters::INSTRUCTIONS]);
+    }
+    REQUIRE(counters.totals().hits == 3);
+}
+
+TEST_CASE("PerfCounters Output", "[perf_counters]") {
+    PerfCounters counters;
+    counters.seed({ 10 });
+
+    SECTION("Report names every event") {
+        std::stringstream out;
+        counters.report(out);
+        REQUIRE(out.str().find("PERFCOUNTERS: 1 lines") != std::string::npos);
+        REQUIRE(out.str().find("cache-misses") != std::string::npos);
+        REQUIRE(out.flags() == std::stringstream().flags());
+        REQUIRE(out.precision() == 6);
+    }
+
+    SECTION("JSON file is written") {
+        std::string temp_filename = "temp_perf.json";
+        counters.write(temp_filename);
+        std::ifstream file(temp_filename);
+        std::stringstream content;
+        content << file.rdbuf();
+        REQUIRE(content.str().find("\"line\": 10, \"hits\": 0") !=
+                std::string::npos);
+        std::filesystem::remove(temp_filename);
+    }
+}
@@ -0,0 +1,60 @@
+#include "../../include/profiler.h"
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+TEST_CASE("Profiler Line Accounting", "[profiler]") {
+    Profiler profiler;
+
+    SECTION("Seeded lines start empty") {
+        profiler.seed({ 10, 20 });
+        REQUIRE(profiler.lines().size() == 2);
+        REQUIRE(profiler.lines().at(10).hits == 0);
+        REQUIRE(profiler.total_cycles() == 0);
+    }
+
+    SECTION("Entering lines counts hits") {
+        profiler.enter(10);
+        profiler.enter(20);
+        profiler.enter(10);
+        profiler.finish();
+        REQUIRE(profiler.lines().at(10).hits == 2);
+        REQUIRE(profiler.lines().at(20).hits == 1);
+    }
+
+    SECTION("Sorted output is ordered by cycles") {
+        profiler.enter(10);
+        profiler.enter(20);
+        profiler.finish();
+        auto entries = profiler.sorted();
+        REQUIRE(entries.size() == 2);
+        REQUIRE(entries[0].second.cycles >= entries[1].second.cycles);
+    }
+}
+
+TEST_CASE("Profiler Output", "[profiler]") {
+    Profiler profiler;
+    profiler.enter(10);
+    profiler.finish();
+
+    SECTION("Report lists the line") {
+        std::stringstream out;
+        profiler.report(out);
+        REQUIRE(out.str().find("PROFILE: 1 lines") != std::string::npos);
+        REQUIRE(out.flags() == std::stringstream().flags());
+        REQUIRE(out.precision() == 6);
+    }
+
+    SECTION("JSON file is written") {
+        std::string temp_filename = "temp_profile.json";
+        profiler.write(temp_filename);
+        std::ifstream file(temp_filename);
+        std::stringstream content;
+        content << file.rdbuf();
+        REQUIRE(content.str().find("\"line\": 10, \"hits\": 1") !=
+                std::string::npos);
+        std::filesystem::remove(temp_filename);
+    }
+}
@@ -0,0 +1,69 @@
+#include "../../include/sampler.h"
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace {
+// Spins for roughly the given CPU time so ITIMER_PROF gets to fire.
+void burn(std::chrono::milliseconds duration) {
+    volatile unsigned long sink = 0;
+    auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end) {
+        sink = sink + 1;
+    }
+}
+} // namespace
+
+TEST_CASE("Sampler Records Current Line", "[sampler]") {
+    std::atomic<int> line{ 0 };
+    Sampler sampler(line, std::chrono::microseconds(500));
+
+    SECTION("Samples land on the line being executed") {
+        sampler.start();
+        line.store(20);
+        burn(std::chrono::milliseconds(60));
+        sampler.stop();
+        REQUIRE_FALSE(sampler.running());
+        REQUIRE(sampler.samples() > 0);
+        REQUIRE(sampler.histogram().count(20) == 1);
+    }
+
+    SECTION("Only one sampler can run at a time") {
+        sampler.start();
+        Sampler other(line, std::chrono::microseconds(500));
+        REQUIRE_THROWS_AS(other.start(), std::runtime_error);
+        sampler.stop();
+        REQUIRE_NOTHROW(other.start());
+        other.stop();
+    }
+}
+
+TEST_CASE("Sampler Folded Output", "[sampler]") {
+    std::atomic<int> line{ 30 };
+    Sampler sampler(line, std::chrono::microseconds(500));
+    sampler.start();
+    burn(std::chrono::milliseconds(30));
+    sampler.stop();
+
+    SECTION("Folded stacks name the program and the line") {
+        std::string temp_filename = "temp_samples.folded";
+        sampler.write_folded(temp_filename, "prog.subaru");
+        std::ifstream file(temp_filename);
+        std::stringstream content;
+        content << file.rdbuf();
+        REQUIRE(content.str().rfind("prog.subaru;line_30 ", 0) == 0);
+        std::filesystem::remove(temp_filename);
+    }
+
+    SECTION("Report lists the line") {
+        std::stringstream out;
+        sampler.report(out);
+        REQUIRE(out.str().find("line") != std::string::npos);
+        REQUIRE(out.str().find("%") != std::string::npos);
+        REQUIRE(out.flags() == std::stringstream().flags());
+        REQUIRE(out.precision() == 6);
+    }
+}
@@ -0,0 +1,47 @@
+#include "../../include/stats.h"
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+TEST_CASE("Stats Totals", "[stats]") {
+    Stats stats;
+    REQUIRE(stats.total_statements() == 0);
+
+    stats.statements[Stats::LET] = 3;
+    stats.statements[Stats::PRINT] = 2;
+    REQUIRE(stats.total_statements() == 5);
+    REQUIRE(std::string(Stats::statement_name(Stats::GOTO)) == "GOTO");
+}
+
+TEST_CASE("Stats Output", "[stats]") {
+    Stats stats;
+    stats.tokens_lexed = 42;
+    stats.statements[Stats::IF] = 7;
+    stats.output_flushes = 3;
+
+    SECTION("Report lists every counter") {
+        std::stringstream out;
+        stats.report(out);
+        REQUIRE(out.str().find("STATS:") != std::string::npos);
+        REQUIRE(out.str().find("tokens lexed") != std::string::npos);
+        REQUIRE(out.str().find("output flushes") != std::string::npos);
+        REQUIRE(out.flags() == std::stringstream().flags());
+        REQUIRE(out.precision() == 6);
+    }
+
+    SECTION("JSON file is written") {
+        std::string temp_filename = "temp_stats.json";
+        stats.write(temp_filename);
+        std::ifstream file(temp_filename);
+        std::stringstream content;
+        content << file.rdbuf();
+        REQUIRE(content.str().find("\"tokens_lexed\": 42") !=
+                std::string::npos);
+        REQUIRE(content.str().find("\"IF\": 7") != std::string::npos);
+        REQUIRE(content.str().find("\"output_flushes\": 3") !=
+                std::string::npos);
+        std::filesystem::remove(temp_filename);
+    }
+}
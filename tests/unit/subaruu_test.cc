@@ -6,6 +6,21 @@
 #include <sstream>
 #include <string>
 
+// Runs a program with windows of 16 bytes, which split it into a window or
+// two per line, and returns what it prints followed by its error, if any
+static std::string run_program(const std::string& filename,
+                               Tokenizer::Loading loading) {
+    std::stringstream output;
+    std::stringstream errors;
+    std::streambuf* old_cout = std::cout.rdbuf(output.rdbuf());
+    std::streambuf* old_cerr = std::cerr.rdbuf(errors.rdbuf());
+    SUBARUU interpreter(filename, loading, 16);
+    const bool succeeded = interpreter.try_run();
+    std::cout.rdbuf(old_cout);
+    std::cerr.rdbuf(old_cerr);
+    return output.str() + (succeeded ? "" : interpreter.error());
+}
+
 TEST_CASE("SUBARU Basic Execution", "[subaru]") {
     SECTION("Running test.subaru") {
         // Capture output
@@ -149,3 +164,756 @@ TEST_CASE("SUBARUU GOTO Statement Tests", "[subaru]") {
     }
 }
 #define CATCH_CONFIG_MAIN
+
+TEST_CASE("SUBARUU Error Locations", "[subaru]") {
+    std::string temp_filename = "temp_error_location.subaru";
+    std::ofstream temp_file(temp_filename);
+    temp_file << "10 LET a = 5\n"
+              << "20 IF a > 3 THEN 45\n"
+              << "30 PRINT \"Unreachable\"\n";
+    temp_file.close();
+
+    SECTION("A missing jump target is reported where it is written") {
+        std::stringstream errors;
+        std::streambuf* old_cerr = std::cerr.rdbuf(errors.rdbuf());
+        std::string message;
+        try {
+            SUBARUU interpreter(temp_filename);
+            interpreter.run();
+        } catch (const std::runtime_error& e) {
+            message = e.what();
+        }
+        std::cerr.rdbuf(old_cerr);
+        REQUIRE(message.find(temp_filename + ":2:18: ") == 0);
+        REQUIRE(message.find("Line number 45 not found") != std::string::npos);
+    }
+
+    SECTION("try_run() reports the failure without throwing") {
+        std::stringstream output;
+        std::stringstream errors;
+        std::streambuf* old_cout = std::cout.rdbuf(output.rdbuf());
+        std::streambuf* old_cerr = std::cerr.rdbuf(errors.rdbuf());
+        SUBARUU interpreter(temp_filename);
+        bool succeeded = true;
+        REQUIRE_NOTHROW(succeeded = interpreter.try_run());
+        std::cout.rdbuf(old_cout);
+        std::cerr.rdbuf(old_cerr);
+        REQUIRE_FALSE(succeeded);
+        REQUIRE(interpreter.failed());
+        REQUIRE(interpreter.finished());
+        REQUIRE(interpreter.error().find(":2:18: ") != std::string::npos);
+        REQUIRE(output.str().empty());
+    }
+
+    SECTION("Every missing jump target is reported before the program "
+            "runs") {
+        std::ofstream program(temp_filename);
+        program << "10 PRINT \"Started\"\n"
+                << "20 IF 0 THEN 45\n"
+                << "30 GOTO 10\n"
+                << "40 GOTO 55\n";
+        program.close();
+
+        std::stringstream output;
+        std::stringstream errors;
+        std::streambuf* old_cout = std::cout.rdbuf(output.rdbuf());
+        std::streambuf* old_cerr = std::cerr.rdbuf(errors.rdbuf());
+        SUBARUU interpreter(temp_filename);
+        interpreter.load();
+        const bool failed = interpreter.failed();
+        const bool succeeded = interpreter.try_run();
+        std::cout.rdbuf(old_cout);
+        std::cerr.rdbuf(old_cerr);
+        REQUIRE(failed);
+        REQUIRE_FALSE(succeeded);
+        REQUIRE(output.str().empty());
+        REQUIRE(interpreter.error().find(":2:14: ") != std::string::npos);
+        REQUIRE(errors.str().find(":2:14: ") != std::string::npos);
+        REQUIRE(errors.str().find(":4:9: ") != std::string::npos);
+        REQUIRE(errors.str().find(":3:") == std::string::npos);
+    }
+    std::filesystem::remove(temp_filename);
+}
+
+TEST_CASE("SUBARUU Per-line Profiling", "[subaru]") {
+    SECTION("Running rrtest.subaru with the profiler") {
+        std::stringstream output;
+        std::streambuf* old_cout = std::cout.rdbuf(output.rdbuf());
+
+        SUBARUU interpreter("tests/rrtest.subaru");
+        interpreter.enable_profiler();
+        REQUIRE_NOTHROW(interpreter.run());
+
+        std::cout.rdbuf(old_cout);
+
+        const auto& lines = interpreter.profiler()->lines();
+        REQUIRE(lines.at(10).hits == 1);
+        REQUIRE(lines.at(20).hits == 3);
+        REQUIRE(lines.at(70).hits == 1);
+    }
+}
+
+TEST_CASE("SUBARUU Runtime Statistics", "[subaru]") {
+    std::stringstream output;
+    std::streambuf* old_cout = std::cout.rdbuf(output.rdbuf());
+    SUBARUU interpreter("tests/rrtest.subaru");
+    interpreter.run();
+    std::cout.rdbuf(old_cout);
+    const Stats stats = interpreter.stats();
+
+    SECTION("Statements are counted by kind") {
+        REQUIRE(stats.statements[Stats::LET] == 4);
+        REQUIRE(stats.statements[Stats::PRINT] == 5);
+        REQUIRE(stats.statements[Stats::IF] == 6);
+        REQUIRE(stats.statements[Stats::GOTO] == 0);
+        REQUIRE(stats.statements[Stats::REM] == 1);
+        REQUIRE(stats.total_statements() == 16);
+    }
+
+    SECTION("Jumps seek through the line table") {
+        REQUIRE(stats.jumps == 4);
+        REQUIRE(stats.tokenizer_resets < stats.jumps);
+        REQUIRE(stats.tokens_skipped == 0);
+    }
+
+    SECTION("Every token is lexed once") {
+        Tokenizer tokenizer("tests/rrtest.subaru");
+        REQUIRE(stats.tokens_lexed == tokenizer.tokens().size());
+    }
+
+    SECTION("Output is counted") {
+        REQUIRE(stats.output_bytes == output.str().size());
+        REQUIRE(stats.output_flushes == 5);
+    }
+}
+
+TEST_CASE("SUBARUU Execution Trace", "[subaru]") {
+    std::string temp_filename = "temp_run_trace.json";
+    {
+        std::stringstream output;
+        std::streambuf* old_cout = std::cout.rdbuf(output.rdbuf());
+        SUBARUU interpreter("tests/rrtest.subaru");
+        interpreter.enable_tracer(temp_filename);
+        REQUIRE_NOTHROW(interpreter.run());
+        std::cout.rdbuf(old_cout);
+    }
+    std::ifstream file(temp_filename);
+    std::stringstream content;
+    content << file.rdbuf();
+    const std::string trace = content.str();
+
+    // Blocks end at each of the four jumps and at the end of the program.
+    REQUIRE(trace.find("\"name\":\"build_line_map\"") != std::string::npos);
+    REQUIRE(trace.find("\"name\":\"load\"") != std::string::npos);
+    REQUIRE(trace.find("\"name\":\"line 10-30\"") != std::string::npos);
+    REQUIRE(trace.find("\"name\":\"line 50-60\"") != std::string::npos);
+    REQUIRE(trace.find("\"name\":\"line 20-70\"") != std::string::npos);
+    REQUIRE(trace.find("\"name\":\"flush\"") != std::string::npos);
+    std::filesystem::remove(temp_filename);
+}
+
+TEST_CASE("SUBARUU Lazy Loading and Streaming", "[subaru]") {
+    const auto lazy = Tokenizer::Loading::LAZY;
+    const auto stream = Tokenizer::Loading::STREAM;
+    const auto whole = Tokenizer::Loading::WHOLE;
+
+    SECTION("Programs print what loaded ones do") {
+        for (const char* filename : { "tests/test.subaru",
+                                      "tests/test1.subaru",
+                                      "tests/test2.subaru",
+                                      "tests/test3.subaru",
+                                      "tests/test4.subaru",
+                                      "tests/rrtest.subaru" }) {
+            REQUIRE(run_program(filename, lazy) ==
+                    run_program(filename, whole));
+            REQUIRE(run_program(filename, stream) ==
+                    run_program(filename, whole));
+        }
+    }
+
+    std::string temp_filename = "temp_stream_run.subaru";
+    std::ofstream temp_file(temp_filename);
+    temp_file << "10 LET a = 0\n"
+              << "20 GOTO 60\n"
+              << "30 PRINT \"Back\", a\n"
+              << "40 IF a > 2 THEN 80\n"
+              << "50 GOTO 60\n"
+              << "60 LET a = a + 1\n"
+              << "70 GOTO 30\n"
+              << "80 IF a = 3 THEN 95\n";
+    temp_file.close();
+
+    SECTION("Jumps go back to lines read before and forward by reading "
+            "on") {
+        const std::string output = run_program(temp_filename, lazy);
+        REQUIRE(output.find("Back 1\nBack 2\nBack 3\n") == 0);
+        REQUIRE(output.find(temp_filename + ":8:18: ") != std::string::npos);
+        REQUIRE(output.find("Line number 95 not found") != std::string::npos);
+        REQUIRE(run_program(temp_filename, stream) == output);
+    }
+
+    SECTION("A program loaded whole fails before it runs") {
+        const std::string output = run_program(temp_filename, whole);
+        REQUIRE(output.find(temp_filename + ":8:18: ") == 0);
+        REQUIRE(output.find("Line number 95 not found") != std::string::npos);
+    }
+
+    SECTION("A lazily loaded program that stops early is not read to the "
+            "end") {
+        std::ofstream program(temp_filename);
+        program << "10 PRINT \"Started\"\n"
+                << "20 IF 1 THEN 40\n"
+                << "30 PRINT \"Skipped\"\n"
+                << "40 LET = 1\n";
+        for (int line = 50; line < 1000; line += 10) {
+            program << line << " PRINT \"Never run\"\n";
+        }
+        program.close();
+
+        std::stringstream output;
+        std::stringstream errors;
+        std::streambuf* old_cout = std::cout.rdbuf(output.rdbuf());
+        std::streambuf* old_cerr = std::cerr.rdbuf(errors.rdbuf());
+        SUBARUU interpreter(temp_filename, lazy, 16);
+        REQUIRE_FALSE(interpreter.try_run());
+        std::cout.rdbuf(old_cout);
+        std::cerr.rdbuf(old_cerr);
+        REQUIRE(output.str() == "Started\n");
+        REQUIRE(interpreter.error().find(":4:8: ") != std::string::npos);
+
+        Tokenizer tokenizer(temp_filename);
+        REQUIRE(interpreter.stats().tokens_lexed < 50);
+        REQUIRE(tokenizer.tokens_lexed() > 300);
+    }
+    std::filesystem::remove(temp_filename);
+}
+
+TEST_CASE("SUBARUU Computed Jumps", "[subaru]") {
+    std::string temp_filename = "temp_computed_jumps.subaru";
+
+    SECTION("ON and GOTO expressions pick their targets") {
+        std::ofstream program(temp_filename);
+        program << "10 LET s = 1\n"
+                << "20 ON s GOTO 100, 205, 300\n"
+                << "30 PRINT \"Done\", s\n"
+                << "40 GOTO 99 * 0 + 1000\n"
+                << "100 PRINT \"One\"\n"
+                << "110 LET s = 2\n"
+                << "120 GOTO 20\n"
+                << "205 PRINT \"Two\"\n"
+                << "210 LET s = 3\n"
+                << "220 GOTO 20\n"
+                << "300 PRINT \"Three\"\n"
+                << "310 LET s = 4\n"
+                << "320 GOTO (s - 4) * 10 + 20\n"
+                << "1000 PRINT \"End\"\n";
+        program.close();
+
+        const std::string expected = "One\nTwo\nThree\nDone 4\nEnd\n";
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::LAZY) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::STREAM) ==
+                expected);
+    }
+
+    SECTION("A computed target that does not exist fails where it is "
+            "written") {
+        std::ofstream program(temp_filename);
+        program << "10 LET a = 7\n"
+                << "20 GOTO a * 10\n"
+                << "30 PRINT \"Unreachable\"\n";
+        program.close();
+
+        const std::string output =
+          run_program(temp_filename, Tokenizer::Loading::WHOLE);
+        REQUIRE(output.find(temp_filename + ":2:9: ") == 0);
+        REQUIRE(output.find("Line number 70 not found") != std::string::npos);
+    }
+
+    SECTION("ON falls through at the end of a last line with no newline") {
+        std::ofstream program(temp_filename);
+        program << "10 LET a = a + 1\n"
+                << "20 PRINT a\n"
+                << "30 ON a GOTO 10";
+        program.close();
+
+        const std::string expected = "1\n2\n";
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::LAZY) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::STREAM) ==
+                expected);
+    }
+    std::filesystem::remove(temp_filename);
+}
+
+TEST_CASE("SUBARUU Subroutines", "[subaru]") {
+    std::string temp_filename = "temp_subroutines.subaru";
+
+    SECTION("GOSUB returns to the line after it, however deep") {
+        std::ofstream program(temp_filename);
+        program << "10 LET n = 1\n"
+                << "20 GOSUB 100\n"
+                << "30 LET n = 2\n"
+                << "40 GOSUB 100\n"
+                << "50 PRINT \"Done\"\n"
+                << "60 GOTO 1000\n"
+                << "100 PRINT \"Call\", n\n"
+                << "110 GOSUB 200 + n\n"
+                << "120 RETURN\n"
+                << "201 PRINT \"One\"\n"
+                << "205 RETURN\n"
+                << "202 PRINT \"Two\"\n"
+                << "210 RETURN\n"
+                << "1000 REM\n";
+        program.close();
+
+        const std::string expected = "Call 1\nOne\nCall 2\nTwo\nDone\n";
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::LAZY) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::STREAM) ==
+                expected);
+    }
+
+    SECTION("RETURN without GOSUB fails") {
+        std::ofstream program(temp_filename);
+        program << "10 PRINT \"Before\"\n"
+                << "20 RETURN\n";
+        program.close();
+
+        const std::string output =
+          run_program(temp_filename, Tokenizer::Loading::WHOLE);
+        REQUIRE(output.find("Before\n" + temp_filename + ":2:4: ") == 0);
+        REQUIRE(output.find("RETURN without GOSUB") != std::string::npos);
+    }
+
+    SECTION("GOSUB and RETURN end a last line with no newline") {
+        std::ofstream program(temp_filename);
+        program << "10 GOTO 30\n"
+                << "20 PRINT \"Sub\" : RETURN\n"
+                << "30 GOSUB 20";
+        program.close();
+
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                "Sub\n");
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::STREAM) ==
+                "Sub\n");
+
+        program.open(temp_filename);
+        program << "10 GOSUB 30\n"
+                << "20 PRINT \"Back\"\n"
+                << "30 RETURN";
+        program.close();
+
+        // Returns once, then falls into the RETURN again
+        const std::string output =
+          run_program(temp_filename, Tokenizer::Loading::WHOLE);
+        REQUIRE(output.find("Back\n" + temp_filename + ":3:4: ") == 0);
+        REQUIRE(output.find("RETURN without GOSUB") != std::string::npos);
+    }
+
+    SECTION("Calls nested deeper than the return stack fail") {
+        std::ofstream program(temp_filename);
+        program << "10 LET d = d + 1\n"
+                << "20 GOSUB 10\n";
+        program.close();
+
+        std::stringstream errors;
+        std::streambuf* old_cerr = std::cerr.rdbuf(errors.rdbuf());
+        SUBARUU interpreter(temp_filename);
+        REQUIRE_FALSE(interpreter.try_run());
+        std::cerr.rdbuf(old_cerr);
+        REQUIRE(interpreter.error().find(":2:4: ") != std::string::npos);
+        REQUIRE(interpreter.error().find(
+                  std::to_string(SUBARUU_GOSUB_DEPTH)) != std::string::npos);
+        REQUIRE(interpreter.stats().statements[Stats::GOSUB] ==
+                SUBARUU_GOSUB_DEPTH + 1);
+    }
+    std::filesystem::remove(temp_filename);
+}
+
+TEST_CASE("SUBARUU FOR Loops", "[subaru]") {
+    std::string temp_filename = "temp_for_loops.subaru";
+
+    SECTION("Loops nest, step either way and may run no times") {
+        std::ofstream program(temp_filename);
+        program << "10 FOR i = 1 TO 2\n"
+                << "20 FOR j = 6 TO 2 STEP 0 - 2\n"
+                << "30 PRINT i, j\n"
+                << "40 NEXT j\n"
+                << "50 NEXT i\n"
+                << "60 FOR k = 5 TO 1\n"
+                << "70 FOR m = 1 TO 3\n"
+                << "80 PRINT \"Never\"\n"
+                << "90 NEXT m\n"
+                << "100 NEXT\n"
+                << "110 PRINT \"Done\", i, k\n";
+        program.close();
+
+        const std::string expected =
+          "1 6\n1 4\n1 2\n2 6\n2 4\n2 2\nDone 3 5\n";
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::LAZY) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::STREAM) ==
+                expected);
+    }
+
+    SECTION("A loop that runs no times goes straight past its NEXT") {
+        std::ofstream program(temp_filename);
+        program << "10 FOR i = 1 TO 0\n"
+                << "20 PRINT \"Never\"\n"
+                << "30 NEXT i\n"
+                << "40 PRINT \"After\"\n";
+        program.close();
+
+        std::stringstream output;
+        std::streambuf* old_cout = std::cout.rdbuf(output.rdbuf());
+        SUBARUU interpreter(temp_filename);
+        REQUIRE(interpreter.try_run());
+        std::cout.rdbuf(old_cout);
+        REQUIRE(output.str() == "After\n");
+        REQUIRE(interpreter.stats().tokens_skipped == 0);
+    }
+
+    SECTION("A NEXT on a last line with no newline ends the program") {
+        std::ofstream program(temp_filename);
+        program << "10 FOR i = 1 TO 2\n"
+                << "20 PRINT i\n"
+                << "30 FOR j = 1 TO 0\n"
+                << "40 NEXT j\n"
+                << "50 NEXT i";
+        program.close();
+
+        const std::string expected = "1\n2\n";
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::LAZY) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::STREAM) ==
+                expected);
+    }
+
+    SECTION("Leaving a loop with GOTO and entering it again starts it over") {
+        std::ofstream program(temp_filename);
+        program << "10 LET n = n + 1\n"
+                << "20 FOR i = 1 TO 3\n"
+                << "30 IF i > 1 THEN 60\n"
+                << "40 NEXT i\n"
+                << "50 GOTO 100\n"
+                << "60 IF n < 100 THEN 10\n"
+                << "70 PRINT \"Left\", n\n"
+                << "100 REM\n";
+        program.close();
+
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                "Left 100\n");
+    }
+
+    SECTION("NEXT without FOR, or for another loop, fails") {
+        std::ofstream program(temp_filename);
+        program << "10 PRINT \"Before\"\n"
+                << "20 NEXT\n";
+        program.close();
+
+        std::string output =
+          run_program(temp_filename, Tokenizer::Loading::WHOLE);
+        REQUIRE(output.find("Before\n" + temp_filename + ":2:4: ") == 0);
+        REQUIRE(output.find("NEXT without FOR") != std::string::npos);
+
+        program.open(temp_filename);
+        program << "10 FOR i = 1 TO 2\n"
+                << "20 NEXT j\n";
+        program.close();
+
+        output = run_program(temp_filename, Tokenizer::Loading::WHOLE);
+        REQUIRE(output.find(":2:4: ") != std::string::npos);
+        REQUIRE(output.find("NEXT j does not match FOR i") !=
+                std::string::npos);
+    }
+
+    SECTION("A loop that runs no times and has no NEXT fails") {
+        std::ofstream program(temp_filename);
+        program << "10 PRINT \"Before\"\n"
+                << "20 FOR i = 1 TO 0\n"
+                << "30 PRINT \"Never\"\n";
+        program.close();
+
+        const std::string expected =
+          "Before\n" + temp_filename + ":2:4: Runtime Error: FOR without NEXT";
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::STREAM) ==
+                expected);
+    }
+    std::filesystem::remove(temp_filename);
+}
+
+TEST_CASE("SUBARUU WHILE Loops", "[subaru]") {
+    std::string temp_filename = "temp_while_loops.subaru";
+
+    SECTION("Loops nest and may run no times") {
+        std::ofstream program(temp_filename);
+        program << "10 WHILE i < 2\n"
+                << "20 LET i = i + 1\n"
+                << "30 LET j = 0\n"
+                << "40 WHILE j < i\n"
+                << "50 LET j = j + 1\n"
+                << "60 PRINT i, j\n"
+                << "70 WEND\n"
+                << "80 WEND\n"
+                << "90 WHILE i > 5\n"
+                << "100 WHILE 1\n"
+                << "110 PRINT \"Never\"\n"
+                << "120 WEND\n"
+                << "130 WEND\n"
+                << "140 PRINT \"Done\", i\n";
+        program.close();
+
+        const std::string expected = "1 1\n2 1\n2 2\nDone 2\n";
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::LAZY) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::STREAM) ==
+                expected);
+    }
+
+    SECTION("A WEND may end a last line with no newline") {
+        std::ofstream program(temp_filename);
+        program << "10 WHILE i < 2\n"
+                << "20 LET i = i + 1\n"
+                << "30 PRINT i\n"
+                << "40 WEND\n"
+                << "50 WHILE 0\n"
+                << "60 PRINT \"Never\"\n"
+                << "70 WEND";
+        program.close();
+
+        const std::string expected = "1\n2\n";
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::LAZY) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::STREAM) ==
+                expected);
+    }
+
+    SECTION("Both ends of a loop are linked at load") {
+        std::ofstream program(temp_filename);
+        program << "10 WHILE n < 50\n"
+                << "20 LET n = n + 1\n"
+                << "30 WEND\n"
+                << "40 WHILE n < 10\n"
+                << "50 PRINT \"Never\"\n"
+                << "60 WEND\n"
+                << "70 PRINT n\n";
+        program.close();
+
+        std::stringstream output;
+        std::streambuf* old_cout = std::cout.rdbuf(output.rdbuf());
+        SUBARUU interpreter(temp_filename);
+        REQUIRE(interpreter.try_run());
+        std::cout.rdbuf(old_cout);
+        REQUIRE(output.str() == "50\n");
+        REQUIRE(interpreter.stats().tokens_skipped == 0);
+        REQUIRE(interpreter.stats().jumps == 50);
+        REQUIRE(interpreter.stats().statements[Stats::WHILE] == 52);
+    }
+
+    SECTION("Leaving a loop with GOTO and entering it again starts it over") {
+        std::ofstream program(temp_filename);
+        program << "10 LET n = n + 1\n"
+                << "20 WHILE 1\n"
+                << "30 IF n < 100 THEN 10\n"
+                << "40 GOTO 60\n"
+                << "50 WEND\n"
+                << "60 PRINT \"Left\", n\n";
+        program.close();
+
+        const std::string expected = "Left 100\n";
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::LAZY) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::STREAM) ==
+                expected);
+    }
+
+    SECTION("WEND without WHILE, or WHILE without WEND, fails") {
+        std::ofstream program(temp_filename);
+        program << "10 PRINT \"Before\"\n"
+                << "20 WEND\n";
+        program.close();
+
+        std::string output =
+          run_program(temp_filename, Tokenizer::Loading::WHOLE);
+        REQUIRE(output.find("Before\n" + temp_filename + ":2:4: ") == 0);
+        REQUIRE(output.find("WEND without WHILE") != std::string::npos);
+
+        program.open(temp_filename);
+        program << "10 PRINT \"Before\"\n"
+                << "20 WHILE 0\n"
+                << "30 PRINT \"Never\"\n";
+        program.close();
+
+        const std::string expected =
+          "Before\n" + temp_filename +
+          ":2:4: Runtime Error: WHILE without WEND";
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::STREAM) ==
+                expected);
+    }
+    std::filesystem::remove(temp_filename);
+}
+
+TEST_CASE("SUBARUU Statement Separators", "[subaru]") {
+    std::string temp_filename = "temp_separators.subaru";
+
+    SECTION("Several statements share a line and its jumps") {
+        std::ofstream program(temp_filename);
+        program << "5 LET b = 1\n"
+                << "10 LET a = a + 1 : LET b = b * 2 : IF a < 9 THEN 10\n"
+                << "20 PRINT a, b : PRINT \"Done\"\n";
+        program.close();
+
+        const std::string expected = "9 512\nDone\n";
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::LAZY) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::STREAM) ==
+                expected);
+
+        std::stringstream output;
+        std::streambuf* old_cout = std::cout.rdbuf(output.rdbuf());
+        SUBARUU interpreter(temp_filename);
+        REQUIRE(interpreter.try_run());
+        std::cout.rdbuf(old_cout);
+        REQUIRE(interpreter.stats().statements[Stats::LET] == 19);
+        REQUIRE(interpreter.stats().jumps == 8);
+    }
+
+    SECTION("Control flow comes back to the middle of a line") {
+        std::ofstream program(temp_filename);
+        program << "10 GOSUB 100 : PRINT \"Back\" : GOTO 30\n"
+                << "20 PRINT \"Never\"\n"
+                << "30 FOR i = 1 TO 3 : PRINT i : NEXT i : PRINT \"Out\"\n"
+                << "40 LET n = 0 : WHILE n < 2 : LET n = n + 1 : WEND\n"
+                << "50 ON n GOTO 20 : PRINT \"On\", n : REM : PRINT\n"
+                << "60 FOR j = 1 TO 0 : PRINT \"Never\" : NEXT : PRINT j\n"
+                << "70 IF n > 5 THEN 20 : PRINT \"Never\" : GOTO 1000\n"
+                << "80 PRINT \"Fell\" : GOTO 1000\n"
+                << "100 PRINT \"Sub\" : RETURN\n"
+                << "1000 REM\n";
+        program.close();
+
+        const std::string expected =
+          "Sub\nBack\n1\n2\n3\nOut\nOn 2\n1\nFell\n";
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::LAZY) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::STREAM) ==
+                expected);
+    }
+
+    SECTION("A false IF skips the rest of its line") {
+        std::ofstream program(temp_filename);
+        program << "10 IF 0 THEN 50 : PRINT \"x\"\n"
+                << "20 IF 1 > 2 THEN 50 : PRINT \"y\" : REM\n"
+                << "30 PRINT \"Next\" : IF 0 THEN 50 : PRINT \"z\"\n"
+                << "50 PRINT \"End\"\n";
+        program.close();
+
+        const std::string expected = "Next\nEnd\n";
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::LAZY) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::STREAM) ==
+                expected);
+    }
+    std::filesystem::remove(temp_filename);
+}
+
+TEST_CASE("SUBARUU Arrays", "[subaru]") {
+    std::string temp_filename = "temp_arrays.subaru";
+
+    SECTION("Elements are read and written by index, apart from scalars") {
+        std::ofstream program(temp_filename);
+        program << "10 DIM a(5), b(2 + 1)\n"
+                << "20 LET a = 100\n"
+                << "30 FOR i = 0 TO 5 : LET a(i) = i * i : NEXT i\n"
+                << "40 LET b(a(2) - 1) = a(a(1) + 2) + a\n"
+                << "50 PRINT a(5), b(3), b(0), a\n";
+        program.close();
+
+        const std::string expected = "25 109 0 100\n";
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::LAZY) ==
+                expected);
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::STREAM) ==
+                expected);
+    }
+
+    SECTION("Indices outside the array fail where it is named") {
+        std::ofstream program(temp_filename);
+        program << "10 DIM a(2)\n"
+                << "20 PRINT a(2)\n"
+                << "30 PRINT a(0 - 1)\n";
+        program.close();
+
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                "0\n" + temp_filename +
+                  ":3:10: Runtime Error: Index -1 is out of range for a(0 to "
+                  "2)");
+
+        program.open(temp_filename);
+        program << "10 LET b(0) = 1\n";
+        program.close();
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                temp_filename + ":1:8: Runtime Error: Array b is not "
+                                "dimensioned");
+    }
+
+    SECTION("An array is dimensioned once, to a size it can have") {
+        std::ofstream program(temp_filename);
+        program << "10 DIM a(1)\n"
+                << "20 DIM a(1)\n";
+        program.close();
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                temp_filename +
+                  ":2:8: Runtime Error: Array a dimensioned twice");
+
+        program.open(temp_filename);
+        program << "10 DIM a(0 - 1)\n";
+        program.close();
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                temp_filename +
+                  ":1:8: Runtime Error: Array a cannot have 0 elements");
+    }
+
+    SECTION("A DIM may end a last line with no newline") {
+        std::ofstream program(temp_filename);
+        program << "10 PRINT \"Start\"\n"
+                << "20 DIM a(3)";
+        program.close();
+
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::WHOLE) ==
+                "Start\n");
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::LAZY) ==
+                "Start\n");
+        REQUIRE(run_program(temp_filename, Tokenizer::Loading::STREAM) ==
+                "Start\n");
+    }
+    std::filesystem::remove(temp_filename);
+}
@@ -1,5 +1,7 @@
 #include "../../include/tokenizer.h"
 #include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
 #include <string>
 
 TEST_CASE("Tokenizer Basic Operations", "[tokenizer]") {
@@ -65,9 +67,8 @@ TEST_CASE("Tokenizer Complex Expressions", "[tokenizer]") {
     SECTION("Multiple operations") {
         bool found_arithmetic = false;
         while (!tokenizer.finished()) {
-            const auto& data = tokenizer.get_token_data();
             // Just checking if we can iterate through tokens
-            if (std::holds_alternative<int>(data)) {
+            if (tokenizer.current_token() == Tokenizer::TokenType::NUMBER) {
                 found_arithmetic = true;
                 break;
             }
@@ -81,11 +82,13 @@ TEST_CASE("Tokenizer Reset Functionality", "[tokenizer]") {
     Tokenizer tokenizer("tests/test.subaru");
 
     SECTION("Reset after navigation") {
-        auto first_token_data = tokenizer.get_token_data();
+        const auto first_type = tokenizer.current_token();
+        const int first_num = tokenizer.get_num();
         tokenizer.next_token();
         tokenizer.next_token();
         tokenizer.reset();
-        REQUIRE(tokenizer.get_token_data() == first_token_data);
+        REQUIRE(tokenizer.current_token() == first_type);
+        REQUIRE(tokenizer.get_num() == first_num);
     }
 }
 
@@ -101,3 +104,291 @@ TEST_CASE("Tokenizer String Content", "[tokenizer]") {
 }
 
 #define CATCH_CONFIG_MAIN
+
+TEST_CASE("Tokenizer Packed Token Array", "[tokenizer]") {
+    Tokenizer tokenizer("tests/test2.subaru");
+    const auto& tokens = tokenizer.tokens();
+
+    SECTION("The array ends with EOF and is counted as lexed") {
+        REQUIRE_FALSE(tokens.empty());
+        REQUIRE(tokens.back().type == Tokenizer::TokenType::EOF_TOKEN);
+        REQUIRE(tokenizer.tokens_lexed() == tokens.size());
+    }
+
+    SECTION("Only the first number on a line is a line number") {
+        // 30 IF a > 3 THEN 50
+        while (tokenizer.get_num() != 30) {
+            tokenizer.next_token();
+        }
+        REQUIRE(tokenizer.is_line_number());
+        while (tokenizer.current_token() != Tokenizer::TokenType::THEN) {
+            tokenizer.next_token();
+        }
+        tokenizer.next_token();
+        REQUIRE(tokenizer.get_num() == 50);
+        REQUIRE_FALSE(tokenizer.is_line_number());
+    }
+
+    SECTION("Strings come from the literal pool") {
+        while (tokenizer.current_token() != Tokenizer::TokenType::STRING) {
+            tokenizer.next_token();
+        }
+        REQUIRE(tokenizer.get_string() == "The value of a is: ");
+        tokenizer.next_token();
+        REQUIRE(tokenizer.get_string().empty());
+    }
+}
+
+TEST_CASE("Tokenizer REM Text Is Not Lexed", "[tokenizer]") {
+    Tokenizer tokenizer("tests/REM.subaru");
+
+    SECTION("A REM is followed by the end of its line") {
+        tokenizer.next_token(); // Skip line number
+        REQUIRE(tokenizer.current_token() == Tokenizer::TokenType::REM);
+        tokenizer.next_token();
+        REQUIRE(tokenizer.current_token() == Tokenizer::TokenType::EOL);
+    }
+}
+
+TEST_CASE("Tokenizer Keywords", "[tokenizer]") {
+    std::string temp_filename = "temp_keyword_tokens.subaru";
+    std::ofstream temp_file(temp_filename);
+    temp_file << "10 Print a\n"
+              << "20 GOTOX\n";
+    temp_file.close();
+
+    SECTION("Keywords match in any case, and only as whole words") {
+        Tokenizer tokenizer(temp_filename);
+        tokenizer.next_token();
+        REQUIRE(tokenizer.current_token() == Tokenizer::TokenType::PRINT);
+        tokenizer.next_token();
+        REQUIRE(tokenizer.current_token() == Tokenizer::TokenType::LETTER);
+        tokenizer.next_token();
+        tokenizer.next_token();
+        tokenizer.next_token();
+        REQUIRE(tokenizer.current_token() == Tokenizer::TokenType::ERROR);
+    }
+    std::filesystem::remove(temp_filename);
+}
+
+TEST_CASE("Tokenizer Statement Separators", "[tokenizer]") {
+    std::string temp_filename = "temp_separator_tokens.subaru";
+    std::ofstream temp_file(temp_filename);
+    temp_file << "10 LET a = 1 : PRINT a:REM a : b\n"
+              << "20 GOTO 10\n";
+    temp_file.close();
+
+    SECTION("A ':' is a token of its own and does not start a line") {
+        Tokenizer tokenizer(temp_filename);
+        while (tokenizer.current_token() != Tokenizer::TokenType::COLON) {
+            tokenizer.next_token();
+        }
+        tokenizer.next_token();
+        REQUIRE(tokenizer.current_token() == Tokenizer::TokenType::PRINT);
+        REQUIRE_FALSE(tokenizer.token().flags & Tokenizer::LINE_START);
+        tokenizer.next_token();
+        tokenizer.next_token();
+        REQUIRE(tokenizer.current_token() == Tokenizer::TokenType::COLON);
+        tokenizer.next_token();
+        REQUIRE(tokenizer.current_token() == Tokenizer::TokenType::REM);
+        tokenizer.next_token();
+        REQUIRE(tokenizer.current_token() == Tokenizer::TokenType::EOL);
+        REQUIRE(tokenizer.lines().size() == 2);
+    }
+    std::filesystem::remove(temp_filename);
+}
+
+TEST_CASE("Tokenizer Source Locations", "[tokenizer]") {
+    Tokenizer tokenizer("tests/test3.subaru");
+
+    SECTION("Tokens map back to their line and column") {
+        // 30 IF a > 3 THEN 50, the fourth line
+        while (tokenizer.get_num() != 30) {
+            tokenizer.next_token();
+        }
+        auto where = tokenizer.location(tokenizer.position());
+        REQUIRE(where.line == 4);
+        REQUIRE(where.column == 1);
+        while (tokenizer.current_token() != Tokenizer::TokenType::THEN) {
+            tokenizer.next_token();
+        }
+        tokenizer.next_token();
+        where = tokenizer.location(tokenizer.position());
+        REQUIRE(where.line == 4);
+        REQUIRE(where.column == 18);
+    }
+
+    SECTION("The first token is at 1:1") {
+        const auto where = tokenizer.location(0);
+        REQUIRE(where.line == 1);
+        REQUIRE(where.column == 1);
+    }
+}
+
+TEST_CASE("Tokenizer Long Numbers", "[tokenizer]") {
+    std::string temp_filename = "temp_long_number.subaru";
+    std::ofstream temp_file(temp_filename);
+    temp_file << "10 PRINT 123456789\n";
+    temp_file.close();
+
+    SECTION("Digits past the literal limit start another number") {
+        Tokenizer tokenizer(temp_filename);
+        tokenizer.next_token(); // Skip line number
+        tokenizer.next_token(); // Skip PRINT
+        REQUIRE(tokenizer.get_num() == 12345678);
+        tokenizer.next_token();
+        REQUIRE(tokenizer.current_token() == Tokenizer::TokenType::NUMBER);
+        REQUIRE(tokenizer.get_num() == 9);
+    }
+    std::filesystem::remove(temp_filename);
+}
+
+TEST_CASE("Tokenizer Streaming", "[tokenizer]") {
+    std::string temp_filename = "temp_stream_tokens.subaru";
+    std::ofstream temp_file(temp_filename);
+    temp_file << "REM Windows of 16 bytes split this program\n"
+              << "10 LET a = 1\n"
+              << "20 PRINT \"Value:\", a\n"
+              << "30 LET a = a + 1\n"
+              << "40 IF a < 4 THEN 20\n"
+              << "50 PRINT \"Done\"\n";
+    temp_file.close();
+
+    SECTION("Streamed tokens are the tokens of the whole file") {
+        Tokenizer whole(temp_filename);
+        Tokenizer streamed(temp_filename, Tokenizer::Loading::STREAM, 16);
+        REQUIRE(streamed.streaming());
+        while (!whole.finished()) {
+            REQUIRE_FALSE(streamed.finished());
+            REQUIRE(streamed.current_token() == whole.current_token());
+            REQUIRE(streamed.token().flags == whole.token().flags);
+            // Each window has its own literal pool
+            if (whole.current_token() == Tokenizer::TokenType::STRING) {
+                REQUIRE(streamed.get_string() == whole.get_string());
+            } else {
+                REQUIRE(streamed.token().value == whole.token().value);
+            }
+            const auto expected = whole.location(whole.position());
+            const auto where = streamed.location(streamed.position());
+            REQUIRE(where.line == expected.line);
+            REQUIRE(where.column == expected.column);
+            whole.next_token();
+            streamed.next_token();
+        }
+        REQUIRE(streamed.finished());
+        REQUIRE(streamed.tokens_lexed() == whole.tokens_lexed() + 5);
+    }
+
+    SECTION("Lines lexed before are found through the line index") {
+        Tokenizer tokenizer(temp_filename, Tokenizer::Loading::STREAM, 16);
+        REQUIRE_FALSE(tokenizer.find_line(50));
+        REQUIRE(tokenizer.scan_to_line(50));
+        REQUIRE(tokenizer.get_num() == 50);
+        REQUIRE(tokenizer.find_line(20));
+        REQUIRE(tokenizer.is_line_number());
+        REQUIRE(tokenizer.get_num() == 20);
+        REQUIRE(tokenizer.location(tokenizer.position()).line == 3);
+        REQUIRE_FALSE(tokenizer.scan_to_line(60));
+    }
+
+    SECTION("A marked position is restored after its window is gone") {
+        Tokenizer tokenizer(temp_filename, Tokenizer::Loading::STREAM, 16);
+        REQUIRE(tokenizer.scan_to_line(20));
+        tokenizer.next_token();
+        tokenizer.next_token();
+        REQUIRE(tokenizer.current_token() == Tokenizer::TokenType::STRING);
+        const Tokenizer::Mark mark = tokenizer.mark(tokenizer.position());
+
+        tokenizer.restore(mark);
+        REQUIRE(tokenizer.get_string() == "Value:");
+        REQUIRE(tokenizer.scan_to_line(50));
+        tokenizer.restore(mark);
+        REQUIRE(tokenizer.get_string() == "Value:");
+        const auto where = tokenizer.location(tokenizer.position());
+        REQUIRE(where.line == 3);
+        REQUIRE(where.column == 10);
+    }
+    std::filesystem::remove(temp_filename);
+}
+
+TEST_CASE("Tokenizer Parallel Lexing", "[tokenizer]") {
+    std::string temp_filename = "temp_parallel_tokens.subaru";
+    const auto write = [&](const std::string& source) {
+        std::ofstream temp_file(temp_filename);
+        temp_file << source;
+    };
+    // Chunks of 24 bytes or so put each line in a chunk of its own, lexed
+    // on two threads even on a single core.
+    const auto same_as_serial = [&]() {
+        Tokenizer serial(temp_filename);
+        Tokenizer parallel(
+          temp_filename, Tokenizer::Loading::WHOLE, 0, 24, 2);
+        REQUIRE(parallel.tokens().size() == serial.tokens().size());
+        for (std::size_t i = 0; i < serial.tokens().size(); ++i) {
+            const auto& expected = serial.tokens()[i];
+            const auto& token = parallel.tokens()[i];
+            REQUIRE(token.type == expected.type);
+            REQUIRE(token.flags == expected.flags);
+            REQUIRE(token.value == expected.value);
+            REQUIRE(parallel.location(i).line == serial.location(i).line);
+            REQUIRE(parallel.location(i).column == serial.location(i).column);
+            if (token.type == Tokenizer::TokenType::STRING) {
+                REQUIRE(parallel.literal(token.value) ==
+                        serial.literal(expected.value));
+            }
+        }
+        REQUIRE(parallel.lines().size() == serial.lines().size());
+        for (std::size_t i = 0; i < serial.lines().size(); ++i) {
+            REQUIRE(parallel.lines()[i].line == serial.lines()[i].line);
+            REQUIRE(parallel.lines()[i].token == serial.lines()[i].token);
+            REQUIRE(parallel.lines()[i].offset == serial.lines()[i].offset);
+        }
+    };
+
+    SECTION("Chunks stitch together into the serial token array") {
+        write("REM Lexed in chunks\n"
+              "10 LET a = 1\n"
+              "20 PRINT \"Value:\", a, \"and more\"\n"
+              "\n"
+              "   30 LET a = a + 1\n"
+              "40 IF a < 4 THEN 20\r\n"
+              "50 PRINT \"Done\"");
+        same_as_serial();
+    }
+
+    SECTION("A string that runs on past a newline is lexed serially") {
+        write("10 PRINT \"never closed\n"
+              "20 PRINT \"the rest\"\n"
+              "30 PRINT \"of the program\"\n");
+        same_as_serial();
+    }
+    std::filesystem::remove(temp_filename);
+}
+
+TEST_CASE("Tokenizer Lazy Loading", "[tokenizer]") {
+    SECTION("Windows are lexed as they are reached into one array") {
+        Tokenizer whole("tests/rrtest.subaru");
+        Tokenizer lazy("tests/rrtest.subaru", Tokenizer::Loading::LAZY, 16);
+        REQUIRE(lazy.tokens().size() < whole.tokens().size());
+        while (!whole.finished()) {
+            REQUIRE(lazy.current_token() == whole.current_token());
+            REQUIRE(lazy.token().value == whole.token().value);
+            REQUIRE(lazy.position() == whole.position());
+            whole.next_token();
+            lazy.next_token();
+        }
+        REQUIRE(lazy.finished());
+        REQUIRE(lazy.tokens().size() == whole.tokens().size());
+        REQUIRE(lazy.lines().size() == whole.lines().size());
+        REQUIRE(lazy.location(lazy.position()).line ==
+                whole.location(whole.position()).line);
+    }
+
+    SECTION("A line not lexed yet is found by reading on") {
+        Tokenizer lazy("tests/rrtest.subaru", Tokenizer::Loading::LAZY, 16);
+        REQUIRE(lazy.scan_to_line(60));
+        REQUIRE(lazy.get_num() == 60);
+        REQUIRE(lazy.location(lazy.position()).line == 7);
+        REQUIRE_FALSE(lazy.scan_to_line(80));
+    }
+}
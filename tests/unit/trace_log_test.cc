@@ -0,0 +1,50 @@
+#include "../../include/common.h"
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+TEST_CASE("Trace Category Parsing", "[trace_log]") {
+    unsigned mask = 0;
+
+    SECTION("Single and listed categories") {
+        REQUIRE(parse_trace_categories("jumps", mask));
+        REQUIRE(mask == static_cast<unsigned>(TraceCategory::JUMPS));
+        REQUIRE(parse_trace_categories("lexer,output", mask));
+        REQUIRE(mask == (static_cast<unsigned>(TraceCategory::LEXER) |
+                         static_cast<unsigned>(TraceCategory::OUTPUT)));
+    }
+
+    SECTION("All categories") {
+        REQUIRE(parse_trace_categories("all", mask));
+        REQUIRE(mask == TRACE_ALL);
+    }
+
+    SECTION("Unknown names leave the mask alone") {
+        mask = 7;
+        REQUIRE_FALSE(parse_trace_categories("jumps,nonsense", mask));
+        REQUIRE(mask == 7);
+    }
+}
+
+TEST_CASE("Trace Log Records", "[trace_log]") {
+    std::string temp_filename = "temp_trace.log";
+    const unsigned saved = trace_categories;
+
+    trace_log().open(temp_filename);
+    trace_categories = static_cast<unsigned>(TraceCategory::JUMPS);
+    int formatted = 0;
+    TRACE_LOG(JUMPS, "jump to line " << 20);
+    TRACE_LOG(LEXER, "not logged " << ++formatted);
+    trace_log().flush();
+    trace_categories = saved;
+
+    std::ifstream file(temp_filename);
+    std::stringstream content;
+    content << file.rdbuf();
+    REQUIRE(content.str() == "jumps: jump to line 20\n");
+    // Disabled categories do not even evaluate their message.
+    REQUIRE(formatted == 0);
+    std::filesystem::remove(temp_filename);
+}
@@ -0,0 +1,108 @@
+#include "../../include/tracer.h"
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+// Reads the whole trace file back.
+std::string read_file(const std::string& path) {
+    std::ifstream file(path);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+} // namespace
+
+TEST_CASE("Tracer Events", "[tracer]") {
+    std::string temp_filename = "temp_trace.json";
+
+    SECTION("Spans and line blocks are written") {
+        {
+            Tracer tracer(temp_filename);
+            {
+                Tracer::Span span(&tracer, "load", "load");
+            }
+            tracer.line(10);
+            tracer.line(20);
+            tracer.line(30);
+            tracer.jump();
+            tracer.line(20);
+            tracer.close();
+            REQUIRE(tracer.events() == 3);
+        }
+        const std::string trace = read_file(temp_filename);
+        REQUIRE(trace.front() == '[');
+        REQUIRE(trace.find("\"name\":\"load\",\"cat\":\"load\",\"ph\":\"X\"") !=
+                std::string::npos);
+        REQUIRE(trace.find("\"name\":\"line 10-30\"") != std::string::npos);
+        REQUIRE(trace.find("\"args\":{\"lines\":3}") != std::string::npos);
+        REQUIRE(trace.find("\"name\":\"line 20\"") != std::string::npos);
+        REQUIRE(trace.find("\n]\n") != std::string::npos);
+    }
+
+    SECTION("Long names are cut to fit an event") {
+        {
+            Tracer tracer(temp_filename);
+            const std::string name(100, 'n');
+            {
+                Tracer::Span span(&tracer, name.c_str(), "load");
+            }
+            tracer.line(-2147483647 - 1);
+            tracer.line(2147483647);
+            tracer.jump();
+        }
+        const std::string trace = read_file(temp_filename);
+        REQUIRE(trace.find(std::string(64, 'n') + "\"") != std::string::npos);
+        REQUIRE(trace.find(std::string(65, 'n')) == std::string::npos);
+        REQUIRE(trace.find("\"name\":\"line -2147483648-2147483647\"") !=
+                std::string::npos);
+    }
+
+    SECTION("A null tracer makes spans free") {
+        Tracer::Span span(nullptr, "nothing", "load");
+    }
+
+    std::filesystem::remove(temp_filename);
+}
+
+TEST_CASE("Tracer Size Controls", "[tracer]") {
+    std::string temp_filename = "temp_trace.json";
+
+    SECTION("Only sampled blocks are written") {
+        Tracer tracer(temp_filename, 4);
+        for (int block = 0; block < 8; ++block) {
+            tracer.line(10);
+            tracer.jump();
+        }
+        REQUIRE(tracer.events() == 2);
+        int flushes = 0;
+        for (int i = 0; i < 8; ++i) {
+            flushes += tracer.sample_flush();
+        }
+        REQUIRE(flushes == 2);
+    }
+
+    SECTION("Events past the limit are dropped") {
+        {
+            Tracer tracer(temp_filename, 1, 5);
+            for (int block = 0; block < 8; ++block) {
+                tracer.line(10);
+                tracer.jump();
+            }
+            REQUIRE(tracer.events() == 5);
+            REQUIRE(tracer.dropped() == 3);
+        }
+        REQUIRE(read_file(temp_filename).find("\"dropped\":3") !=
+                std::string::npos);
+    }
+
+    SECTION("Missing directories are reported") {
+        REQUIRE_THROWS_AS(Tracer("no/such/dir/trace.json"),
+                          std::runtime_error);
+    }
+
+    std::filesystem::remove(temp_filename);
+}